@@ -0,0 +1,302 @@
+/*
+  Benchmark runner of Kagami Project.
+  Every script in benchmark directory is executed several times inside one
+  process, and result is written as JSON. Result of previous run can be
+  given as baseline, then slower scripts are reported as regressions.
+  Global operator new is replaced here to count heap allocations made while
+  scripts are running.
+*/
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include "libkagami.h"
+#include "argument.h"
+
+using namespace std;
+using namespace suzu;
+using namespace kagami;
+using Processor = ArgumentProcessor<kHeadHorizon, kJoinerEqual>;
+
+#if defined(_WIN32)
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+namespace bench {
+  const size_t kDefaultIterations = 10;
+  const double kDefaultThreshold = 10.0;
+
+  std::atomic<uint64_t> heap_allocations(0);
+
+  struct BenchResult {
+    string name;
+    double median;
+    double p95;
+    uint64_t instructions;
+    double ips;
+    uint64_t allocations;
+    double allocs_per_inst;
+    bool error;
+  };
+
+  uint64_t CountInstructions() {
+    auto stats = GetRuntimeStats();
+    uint64_t result = stats.calls;
+
+    for (auto &unit : stats.commands) {
+      result += unit;
+    }
+
+    return result;
+  }
+
+  double Percentile(vector<double> samples, double rank) {
+    std::sort(samples.begin(), samples.end());
+    size_t idx = static_cast<size_t>(rank * static_cast<double>(samples.size() - 1) + 0.5);
+    return samples[idx];
+  }
+
+  uint64_t CountAllocations() {
+    return heap_allocations.load(std::memory_order_relaxed);
+  }
+
+  BenchResult RunScript(string path, size_t iterations, DispatchMode mode) {
+    using Clock = std::chrono::steady_clock;
+    BenchResult result{ std::filesystem::path(path).stem().string(), 0, 0, 0, 0, 0, 0, false };
+    vector<double> samples;
+    uint64_t instructions = 0, allocations = 0;
+
+    //Script is compiled once, only running of it is measured.
+    CompiledScript script(path);
+
+    if (!script.Good()) {
+      result.error = true;
+      return result;
+    }
+
+    for (size_t count = 0; count < iterations; ++count) {
+      Instance instance(script);
+      instance.SetDispatchMode(mode).SetStats(true);
+
+      uint64_t last_count = CountInstructions();
+      uint64_t last_allocations = CountAllocations();
+      auto begin = Clock::now();
+      bool good = instance.Run();
+      auto end = Clock::now();
+
+      if (!good) result.error = true;
+
+      instructions += CountInstructions() - last_count;
+      allocations += CountAllocations() - last_allocations;
+      samples.push_back(
+        std::chrono::duration<double, std::milli>(end - begin).count());
+    }
+
+    double total = 0;
+    for (auto &unit : samples) total += unit;
+
+    result.median = Percentile(samples, 0.5);
+    result.p95 = Percentile(samples, 0.95);
+    result.instructions = instructions / iterations;
+    result.ips = total > 0 ?
+      static_cast<double>(instructions) / (total / 1000.0) : 0;
+    result.allocations = allocations / iterations;
+    result.allocs_per_inst = instructions > 0 ?
+      static_cast<double>(allocations) / static_cast<double>(instructions) : 0;
+    return result;
+  }
+
+  //Baseline file is the JSON written by this tool, one result per line.
+  map<string, double> LoadBaseline(string path) {
+    map<string, double> result;
+    FILE *fp = fopen(path.data(), "r");
+    if (fp == nullptr) return result;
+
+    const string name_head = "\"name\": \"";
+    const string median_head = "\"median_ms\": ";
+    char buf[1024];
+
+    while (fgets(buf, sizeof(buf), fp) != nullptr) {
+      string line(buf);
+      auto name_pos = line.find(name_head);
+      auto median_pos = line.find(median_head);
+      if (name_pos == string::npos || median_pos == string::npos) continue;
+
+      name_pos += name_head.size();
+      string name = line.substr(name_pos, line.find('"', name_pos) - name_pos);
+      result[name] = stod(line.substr(median_pos + median_head.size()));
+    }
+
+    fclose(fp);
+    return result;
+  }
+}
+
+void *operator new(size_t size) {
+  bench::heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = malloc(size == 0 ? 1 : size)) return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void HelpFile(const char *binary_name) {
+  printf("Usage:%s [-OPTION=VALUE]...\n\n", binary_name);
+  printf(
+    "\tdir=PATH            Directory of benchmark scripts.(default=bench)\n"
+    "\titerations=N        Runs of every script.(default=10)\n"
+    "\tdispatch=MODE       Command dispatch of machine.(table|switch)\n"
+    "\tbaseline=FILE       Compare results with previous JSON output.\n"
+    "\tthreshold=PCT       Slowdown reported as regression.(default=10)\n"
+    "\toutput=FILE         Write JSON to FILE instead of stdout.\n"
+    "\tlog=FILE            Output of error log.(default=kagami-bench.log in temp directory)\n"
+  );
+#if not defined(_DISABLE_SDL_)
+  printf(
+    "\tevent_interval=N    Pump window events every N ticks.(default=256)\n"
+  );
+#endif
+}
+
+int main(int argc, char **argv) {
+  InitEmbeddedComponents();
+
+  Processor processor = {
+    Pattern("dir"       , Option(true, true)),
+    Pattern("iterations", Option(true, true)),
+    Pattern("dispatch"  , Option(true, true)),
+    Pattern("baseline"  , Option(true, true)),
+    Pattern("threshold" , Option(true, true)),
+    Pattern("output"    , Option(true, true)),
+    Pattern("log"       , Option(true, true)),
+    Pattern("help"      , Option(false, true)),
+#if not defined(_DISABLE_SDL_)
+    Pattern("event_interval", Option(true, true)),
+#endif
+  };
+
+  if (argc > 1 && !processor.Generate(argc, argv)) {
+    puts(ArgumentProcessorError(processor.Error())
+      .Report(processor.BadArg()).data());
+    HelpFile(argv[0]);
+    return 1;
+  }
+
+  if (processor.Exist("help")) {
+    HelpFile(argv[0]);
+    return 0;
+  }
+
+  string dir = processor.Exist("dir") ? processor.ValueOf("dir") : "bench";
+  size_t iterations = processor.Exist("iterations") ?
+    static_cast<size_t>(stoul(processor.ValueOf("iterations"))) :
+    bench::kDefaultIterations;
+  double threshold = processor.Exist("threshold") ?
+    stod(processor.ValueOf("threshold")) : bench::kDefaultThreshold;
+  //Default log is kept out of source tree
+  string log = processor.Exist("log") ?
+    processor.ValueOf("log") : 
+    (std::filesystem::temp_directory_path() / "kagami-bench.log").string();
+  DispatchMode mode = kDefaultDispatchMode;
+
+  if (processor.Exist("dispatch")) {
+    mode = processor.ValueOf("dispatch") == "switch" ?
+      kDispatchSwitch : kDispatchTable;
+  }
+
+  if (iterations == 0) iterations = 1;
+
+#if not defined(_DISABLE_SDL_)
+  if (dawn::EnvironmentSetup() != 0) {
+    puts("SDL initialization error!");
+    return 1;
+  }
+
+  if (processor.Exist("event_interval")) {
+    GetEventPumpOption().interval =
+      static_cast<size_t>(stoul(processor.ValueOf("event_interval")));
+  }
+#endif
+
+  vector<string> scripts;
+  std::error_code error;
+  for (auto &unit : std::filesystem::directory_iterator(dir, error)) {
+    if (unit.path().extension() == ".kagami") {
+      scripts.push_back(unit.path().string());
+    }
+  }
+
+  if (scripts.empty()) {
+    printf("No benchmark script in %s\n", dir.data());
+    return 1;
+  }
+
+  std::sort(scripts.begin(), scripts.end());
+
+  auto baseline = processor.Exist("baseline") ?
+    bench::LoadBaseline(processor.ValueOf("baseline")) :
+    map<string, double>();
+  FILE *dest = processor.Exist("output") ?
+    fopen(processor.ValueOf("output").data(), "w") : stdout;
+
+  if (dest == nullptr) {
+    puts("Cannot open output file.");
+    return 1;
+  }
+
+  Agent *agent = new minatsuki::StandardCacheAgent(log.data(), "a+");
+  InitRuntime(agent);
+  GetVMStdout(fopen(NULL_DEVICE, "w"));
+
+  size_t regressions = 0;
+  fprintf(dest, "{\n  \"dispatch\": \"%s\",\n  \"iterations\": %zu,\n",
+    mode == kDispatchSwitch ? "switch" : "table", iterations);
+  fprintf(dest, "  \"results\": [\n");
+
+  for (size_t idx = 0; idx < scripts.size(); ++idx) {
+    auto result = bench::RunScript(scripts[idx], iterations, mode);
+
+    fprintf(dest, "    {\"name\": \"%s\", \"median_ms\": %.4f, \"p95_ms\": %.4f, "
+      "\"instructions\": %llu, \"ips\": %.0f, \"allocations\": %llu, "
+      "\"allocs_per_inst\": %.3f",
+      result.name.data(), result.median, result.p95,
+      static_cast<unsigned long long>(result.instructions), result.ips,
+      static_cast<unsigned long long>(result.allocations), result.allocs_per_inst);
+
+    if (result.error) {
+      fprintf(dest, ", \"error\": true");
+    }
+
+    auto it = baseline.find(result.name);
+    if (it != baseline.end() && it->second > 0) {
+      double change = (result.median - it->second) / it->second * 100.0;
+      bool regression = change > threshold;
+      if (regression) regressions += 1;
+      fprintf(dest, ", \"baseline_ms\": %.4f, \"change_pct\": %.2f, \"regression\": %s",
+        it->second, change, regression ? "true" : "false");
+    }
+
+    fprintf(dest, "}%s\n", idx + 1 < scripts.size() ? "," : "");
+  }
+
+  fprintf(dest, "  ],\n  \"regressions\": %zu\n}\n", regressions);
+
+  if (dest != stdout) fclose(dest);
+  CloseStream();
+  StopRuntime();
+  delete agent;
+
+#if not defined(_DISABLE_SDL_)
+  dawn::EnvironmentCleanup();
+#endif
+
+  return regressions == 0 ? 0 : 2;
+}
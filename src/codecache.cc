@@ -0,0 +1,252 @@
+#include <cstring>
+#include "codecache.h"
+
+namespace kagami {
+  const char kCacheMagic[4] = { 'K', 'G', 'B', 'C' };
+  const uint32_t kCacheFormat = 1;
+  const uint32_t kCacheByteOrder = 0x01020304;
+  const string kCacheExtension = ".kbc";
+
+  class CacheWriter {
+  private:
+    string buf_;
+
+  public:
+    CacheWriter() : buf_() {}
+
+    template <class T>
+    void Write(T value) {
+      buf_.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void WriteString(const string &str) {
+      Write<uint32_t>(static_cast<uint32_t>(str.size()));
+      buf_.append(str);
+    }
+
+    void WriteArgument(const Argument &arg) {
+      WriteString(arg.GetData());
+      Write<uint8_t>(static_cast<uint8_t>(arg.GetType()));
+      Write<uint8_t>(static_cast<uint8_t>(arg.GetStringType()));
+    }
+
+    string &GetBuffer() { return buf_; }
+  };
+
+  class CacheReader {
+  private:
+    const char *pos_;
+    const char *end_;
+    bool good_;
+
+  public:
+    CacheReader(const char *data, size_t size) :
+      pos_(data), end_(data + size), good_(true) {}
+
+    template <class T>
+    T Read() {
+      T value{};
+      if (!good_ || static_cast<size_t>(end_ - pos_) < sizeof(T)) {
+        good_ = false;
+        return value;
+      }
+
+      memcpy(&value, pos_, sizeof(T));
+      pos_ += sizeof(T);
+      return value;
+    }
+
+    string ReadString() {
+      auto size = Read<uint32_t>();
+      if (!good_ || static_cast<size_t>(end_ - pos_) < size) {
+        good_ = false;
+        return string();
+      }
+
+      string result(pos_, size);
+      pos_ += size;
+      return result;
+    }
+
+    //Value beyond last enumerator makes whole cache invalid
+    template <class Value, class T>
+    T ReadEnum(T last) {
+      auto value = Read<Value>();
+      if (value > static_cast<Value>(last)) good_ = false;
+      return good_ ? static_cast<T>(value) : last;
+    }
+
+    Argument ReadArgument() {
+      string data = ReadString();
+      auto type = ReadEnum<uint8_t>(kArgumentNull);
+      auto token_type = ReadEnum<uint8_t>(kStringTypeNull);
+      return Argument(data, type, token_type);
+    }
+
+    bool Good() const { return good_; }
+    bool End() const { return pos_ == end_; }
+  };
+
+  string GetCodeCachePath(string path) {
+    return path + kCacheExtension;
+  }
+
+  //FNV-1a over raw bytes of script file
+  uint64_t HashScriptContent(const char *data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t idx = 0; idx < size; ++idx) {
+      hash ^= static_cast<uint8_t>(data[idx]);
+      hash *= 1099511628211ULL;
+    }
+
+    return hash;
+  }
+
+  bool SaveCodeCache(string path, uint64_t hash, VMCode &code) {
+    CacheWriter writer;
+
+    for (auto &unit : kCacheMagic) writer.Write<char>(unit);
+    writer.Write<uint32_t>(kCacheFormat);
+    writer.Write<uint32_t>(kCacheByteOrder);
+    writer.WriteString(INTERPRETER_VER);
+    writer.Write<uint16_t>(static_cast<uint16_t>(kKeywordNull));
+    writer.Write<uint64_t>(hash);
+    writer.Write<uint64_t>(code.size());
+
+    for (auto &command : code) {
+      auto &request = command.first;
+      auto &option = request.option;
+
+      writer.Write<uint8_t>(static_cast<uint8_t>(request.type));
+      writer.Write<uint64_t>(request.idx);
+      writer.Write<uint8_t>(option.void_call ? 1 : 0);
+      writer.Write<uint8_t>(option.local_object ? 1 : 0);
+      writer.Write<uint64_t>(option.nest);
+      writer.Write<uint64_t>(option.nest_end);
+      writer.Write<uint64_t>(option.escape_depth);
+      writer.Write<uint16_t>(static_cast<uint16_t>(option.nest_root));
+      writer.Write<uint16_t>(static_cast<uint16_t>(option.fused_op));
+
+      if (request.type == kRequestCommand) {
+        writer.Write<uint16_t>(static_cast<uint16_t>(request.GetKeywordValue()));
+      }
+      else if (request.type == kRequestExt) {
+        auto &domain = request.GetInterfaceDomain();
+        writer.WriteString(request.GetInterfaceId());
+        writer.WriteArgument(domain);
+      }
+
+      writer.Write<uint32_t>(static_cast<uint32_t>(command.second.size()));
+      for (auto &arg : command.second) writer.WriteArgument(arg);
+    }
+
+    auto &jump_record = code.GetJumpRecords();
+    writer.Write<uint64_t>(jump_record.size());
+    for (auto &unit : jump_record) {
+      writer.Write<uint64_t>(unit.first);
+      writer.Write<uint32_t>(static_cast<uint32_t>(unit.second.size()));
+      for (auto &dest : unit.second) writer.Write<uint64_t>(dest);
+    }
+
+    //Write to temporary file first, so broken cache is never visible
+    string temp_path = path + ".tmp";
+    FILE *fp = fopen(temp_path.data(), "wb");
+    if (fp == nullptr) return false;
+
+    auto &buf = writer.GetBuffer();
+    bool good = fwrite(buf.data(), 1, buf.size(), fp) == buf.size();
+    good = (fclose(fp) == 0) && good;
+
+    std::error_code error;
+    if (good) std::filesystem::rename(temp_path, path, error);
+    if (!good || error) {
+      std::filesystem::remove(temp_path, error);
+      return false;
+    }
+
+    return true;
+  }
+
+  bool LoadCodeCache(string path, uint64_t hash, VMCode &code) {
+    MappedFile file(path);
+    if (!file.Good()) return false;
+
+    CacheReader reader(file.data(), file.size());
+
+    for (auto &unit : kCacheMagic) {
+      if (reader.Read<char>() != unit) return false;
+    }
+
+    if (reader.Read<uint32_t>() != kCacheFormat) return false;
+    if (reader.Read<uint32_t>() != kCacheByteOrder) return false;
+    if (reader.ReadString() != INTERPRETER_VER) return false;
+    if (reader.Read<uint16_t>() != kKeywordNull) return false;
+    if (reader.Read<uint64_t>() != hash) return false;
+
+    deque<Command> result;
+    vector<pair<size_t, list<size_t>>> jump_record;
+    auto count = reader.Read<uint64_t>();
+
+    for (uint64_t idx = 0; idx < count && reader.Good(); ++idx) {
+      auto type = reader.ReadEnum<uint8_t>(kRequestNull);
+      Request request;
+      RequestOption option;
+      ArgumentList args;
+      size_t line = static_cast<size_t>(reader.Read<uint64_t>());
+
+      option.void_call = reader.Read<uint8_t>() != 0;
+      option.local_object = reader.Read<uint8_t>() != 0;
+      option.nest = static_cast<size_t>(reader.Read<uint64_t>());
+      option.nest_end = static_cast<size_t>(reader.Read<uint64_t>());
+      option.escape_depth = static_cast<size_t>(reader.Read<uint64_t>());
+      option.nest_root = reader.ReadEnum<uint16_t>(kKeywordNull);
+      option.fused_op = reader.ReadEnum<uint16_t>(kKeywordNull);
+
+      if (option.nest >= count || option.nest_end >= count) return false;
+
+      if (type == kRequestCommand) {
+        auto keyword = reader.ReadEnum<uint16_t>(kKeywordNull);
+        if (keyword == kKeywordNull) return false;
+        request = Request(keyword);
+      }
+      else if (type == kRequestExt) {
+        string id = reader.ReadString();
+        request = Request(id, reader.ReadArgument());
+      }
+
+      request.idx = line;
+      request.option = option;
+
+      auto argc = reader.Read<uint32_t>();
+      for (uint32_t arg_idx = 0; arg_idx < argc && reader.Good(); ++arg_idx) {
+        args.emplace_back(reader.ReadArgument());
+      }
+
+      result.emplace_back(Command(request, args));
+    }
+
+    auto record_count = reader.Read<uint64_t>();
+    for (uint64_t idx = 0; idx < record_count && reader.Good(); ++idx) {
+      size_t index = static_cast<size_t>(reader.Read<uint64_t>());
+      auto size = reader.Read<uint32_t>();
+      list<size_t> record;
+
+      if (index >= count) return false;
+
+      for (uint32_t dest = 0; dest < size && reader.Good(); ++dest) {
+        record.push_back(static_cast<size_t>(reader.Read<uint64_t>()));
+        if (record.back() >= count) return false;
+      }
+
+      jump_record.emplace_back(index, record);
+    }
+
+    if (!reader.Good() || !reader.End()) return false;
+
+    code.clear();
+    code.insert(code.end(), result.begin(), result.end());
+    for (auto &unit : jump_record) code.AddJumpRecord(unit.first, unit.second);
+    return true;
+  }
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "vmcode.h"
+#include "filestream.h"
+
+namespace kagami {
+  /*
+    Serialized VMCode of script.
+    Cache file is written next to script, and it's only accepted when
+    content hash of script and interpreter version are both matched.
+  */
+  string GetCodeCachePath(string path);
+  uint64_t HashScriptContent(const char *data, size_t size);
+  bool SaveCodeCache(string path, uint64_t hash, VMCode &code);
+  bool LoadCodeCache(string path, uint64_t hash, VMCode &code);
+}
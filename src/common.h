@@ -5,12 +5,15 @@
 #include <cstdlib>
 
 #include <string>
+#include <string_view>
+#include <cstring>
 #include <utility>
 #include <vector>
 #include <memory>
 #include <map>
 #include <unordered_map>
 #include <deque>
+#include <array>
 #include <regex>
 #include <stack>
 #include <type_traits>
@@ -19,6 +22,11 @@
 #include <charconv>
 #include <variant>
 #include <filesystem>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
 
 #if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
@@ -54,6 +62,7 @@ namespace kagami {
   using std::map;
   using std::unordered_map;
   using std::deque;
+  using std::array;
   using std::shared_ptr;
   using std::unique_ptr;
   using std::static_pointer_cast;
@@ -68,6 +77,7 @@ namespace kagami {
   using std::stod;
   using std::stol;
   using std::wstring;
+  using std::string_view;
   using std::list;
   using std::initializer_list;
   using std::is_same;
@@ -75,6 +85,7 @@ namespace kagami {
   using std::from_chars;
   using std::to_chars;
   using std::variant;
+  using std::optional;
   
   using namespace minatsuki;
 
@@ -200,6 +211,28 @@ namespace kagami {
   const string kTypeIdTable           = "table";
   const string kTypeIdStruct          = "struct";
 
+  /* Interned type identifier */
+  using TypeId = uint32_t;
+
+  /* Embedded types are interned in this order */
+  enum BuiltinType : TypeId {
+    kTypeNull,
+    kTypeInt,
+    kTypeFloat,
+    kTypeBool,
+    kTypeString,
+    kTypeWideString,
+    kTypeArray,
+    kTypeInStream,
+    kTypeOutStream,
+    kTypeRegex,
+    kTypeFunction,
+    kTypeIterator,
+    kTypePair,
+    kTypeTable,
+    kTypeStruct
+  };
+
 #ifndef _DISABLE_SDL_
   const string kTypeIdWindowEvent     = "WindowEvent";
   const string kTypeIdWindow          = "window";
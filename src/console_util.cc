@@ -6,13 +6,13 @@ namespace kagami {
   }
 
   Message SystemCommand(ObjectMap &p) {
-    EXPECT_TYPE(p, "command", kTypeIdString);
+    EXPECT_TYPE(p, "command", kTypeString);
     int64_t result = system(p.Cast<string>("command").data());
     return Message().SetObject(Object(result, kTypeIdInt));
   }
 
   Message ThreadSleep(ObjectMap& p) {
-    EXPECT_TYPE(p, "milliseconds", kTypeIdInt);
+    EXPECT_TYPE(p, "milliseconds", kTypeInt);
     auto value = p.Cast<int64_t>("milliseconds");
 #if defined (_WIN32)
     Sleep(DWORD(p.Cast<int64_t>("milliseconds")));
@@ -38,22 +38,22 @@ namespace kagami {
   //Print single object
   Message Print(ObjectMap &p) {
     Object &obj = p[kStrMe];
-    string type_id = obj.GetTypeId();
-    if (util::IsPlainType(type_id)) {
-      if (type_id == kTypeIdInt) {
+    TypeId type = obj.GetType();
+    if (util::IsPlainType(type)) {
+      if (type == kTypeInt) {
 #if not defined (_MSC_VER)
         fprintf(VM_STDOUT, "%ld", obj.Cast<int64_t>());
 #else
         fprintf(VM_STDOUT, "%lld", obj.Cast<int64_t>());
 #endif
       }
-      else if (type_id == kTypeIdFloat) {
+      else if (type == kTypeFloat) {
         fprintf(VM_STDOUT, "%f", obj.Cast<double>());
       }
-      else if (type_id == kTypeIdString) {
+      else if (type == kTypeString) {
         fputs(obj.Cast<string>().data(), VM_STDOUT);
       }
-      else if (type_id == kTypeIdBool) {
+      else if (type == kTypeBool) {
         fputs(obj.Cast<bool>() ? "true" : "false", VM_STDOUT);
       }
 
@@ -62,9 +62,9 @@ namespace kagami {
       return Message();
     }
 
-    vector<string> methods = management::type::GetMethods(obj.GetTypeId());
+    vector<string> methods = management::type::GetMethods(obj.GetType());
 
-    if (!management::type::CheckMethod(kStrPrint, obj.GetTypeId())) {
+    if (!management::type::CheckMethod(kStrPrint, obj.GetType())) {
       puts(MakeObjectString(obj).data());
       return Message();
     }
@@ -81,10 +81,10 @@ namespace kagami {
 
   Message Input(ObjectMap &p) {
     auto &msg = p["msg"];
-    auto type_id = msg.GetTypeId();
+    TypeId type = msg.GetType();
 
     if (!msg.Null()) {
-      EXPECT(type_id == kTypeIdString || type_id == kTypeIdWideString,
+      EXPECT(type == kTypeString || type == kTypeWideString,
         "Illegal message string.");
       
       ObjectMap obj_map = {
@@ -108,6 +108,19 @@ namespace kagami {
     return Message();
   }
 
+  //Snapshot of runtime counters, keyed by counter name
+  Message RuntimeStatistics(ObjectMap &) {
+    ManagedTable table = MakePooled<ObjectTable>();
+    auto &buffer = table->Write();
+
+    for (auto &unit : CollectRuntimeStats()) {
+      buffer.insert(std::make_pair(Object(unit.first),
+        Object(static_cast<int64_t>(unit.second), kTypeIdInt)));
+    }
+
+    return Message().SetObject(Object(table, kTypeIdTable));
+  }
+
   void InitConsoleComponents() {
     using management::CreateImpl;
 
@@ -118,5 +131,6 @@ namespace kagami {
     CreateImpl(FunctionImpl(SystemCommand, "command", "console"));
     CreateImpl(FunctionImpl(ThreadSleep, "milliseconds", "sleep"));
     CreateImpl(FunctionImpl(Test, "obj", "InvokeTest"));
+    CreateImpl(FunctionImpl(RuntimeStatistics, "", "runtime_stats"));
   }
 }
@@ -14,7 +14,7 @@ namespace kagami {
   }
 
   Message IteratorOperatorCompare(ObjectMap &p) {
-    EXPECT_TYPE(p, kStrRightHandSide, kTypeIdIterator);
+    EXPECT_TYPE(p, kStrRightHandSide, kTypeIterator);
     auto &rhs = p[kStrRightHandSide].Cast<UnifiedIterator>();
     auto &lhs = p[kStrMe].Cast<UnifiedIterator>();
     return Message().SetObject(lhs.Compare(rhs));
@@ -32,7 +32,7 @@ namespace kagami {
   }
 
   Message NewArray(ObjectMap &p) {
-    ManagedArray base = make_shared<ObjectArray>();
+    ManagedArray base = MakePooled<ObjectArray>();
 
     if (!p["size"].Null()) {
       size_t size = p.Cast<int64_t>("size");
@@ -40,10 +40,10 @@ namespace kagami {
 
       Object obj = p["init_value"];
 
-      auto type_id = obj.GetTypeId();
+      auto &buffer = base->Write();
 
       for (size_t count = 0; count < size; count++) {
-        base->emplace_back(management::type::CreateObjectCopy(obj));
+        buffer.emplace_back(management::type::CreateObjectCopy(obj));
       }
     }
 
@@ -51,9 +51,10 @@ namespace kagami {
   }
 
   Message ArrayGetElement(ObjectMap &p) {
-    EXPECT_TYPE(p, "index", kTypeIdInt);
+    EXPECT_TYPE(p, "index", kTypeInt);
 
-    ObjectArray &base = p.Cast<ObjectArray>(kStrMe);
+    //Element may be written through the reference
+    auto &base = p.Cast<ObjectArray>(kStrMe).Leak();
     size_t idx = p.Cast<int64_t>("index");
     size_t size = base.size();
 
@@ -64,16 +65,16 @@ namespace kagami {
 
   Message ArrayGetSize(ObjectMap &p) {
     auto &obj = p[kStrMe];
-    int64_t size = static_cast<int64_t>(obj.Cast<ObjectArray>().size());
-    return Message().SetObject(Object(make_shared<int64_t>(size), kTypeIdInt));
+    int64_t size = static_cast<int64_t>(obj.Cast<ObjectArray>().Read().size());
+    return Message().SetObject(Object(size, kTypeIdInt));
   }
 
   Message ArrayEmpty(ObjectMap &p) {
-    return Message().SetObject(p[kStrMe].Cast<ObjectArray>().empty());
+    return Message().SetObject(p[kStrMe].Cast<ObjectArray>().Read().empty());
   }
 
   Message ArrayPush(ObjectMap &p) {
-    ObjectArray &base = p.Cast<ObjectArray>(kStrMe);
+    auto &base = p.Cast<ObjectArray>(kStrMe).Write();
     Object obj = management::type::CreateObjectCopy(p["object"]);
     base.emplace_back(obj);
 
@@ -81,35 +82,38 @@ namespace kagami {
   }
 
   Message ArrayPop(ObjectMap &p) {
-    ObjectArray &base = p.Cast<ObjectArray>(kStrMe);
+    auto &base = p.Cast<ObjectArray>(kStrMe).Write();
     if (!base.empty()) base.pop_back();
 
     return Message().SetObject(base.empty());
   }
 
+  //Iterator of array unpacks references to elements.
+  //Head and tail must be taken from the same buffer, and for-each writes
+  //elements through the head iterator.
   Message ArrayHead(ObjectMap &p) {
-    auto &base = p[kStrMe].Cast<ObjectArray>();
+    auto &base = p[kStrMe].Cast<ObjectArray>().Leak();
     shared_ptr<UnifiedIterator> it = 
-      make_shared<UnifiedIterator>(base.begin(), kContainerObjectArray);
+      MakePooled<UnifiedIterator>(base.begin(), kContainerObjectArray);
     return Message().SetObject(Object(it, kTypeIdIterator));
   }
 
   Message ArrayTail(ObjectMap &p) {
-    auto &base = p[kStrMe].Cast<ObjectArray>();
+    auto &base = p[kStrMe].Cast<ObjectArray>().Leak();
     shared_ptr<UnifiedIterator> it = 
-      make_shared<UnifiedIterator>(base.end(), kContainerObjectArray);
+      MakePooled<UnifiedIterator>(base.end(), kContainerObjectArray);
     return Message().SetObject(Object(it, kTypeIdIterator));
   }
 
   Message ArrayClear(ObjectMap &p) {
-    auto &base = p.Cast<ObjectArray>(kStrMe);
+    auto &base = p.Cast<ObjectArray>(kStrMe).Write();
     base.clear();
     base.shrink_to_fit();
     return Message();
   }
 
   size_t ArrayHasher(shared_ptr<void> ptr) {
-    auto &base = *static_pointer_cast<ObjectArray>(ptr);
+    auto &base = static_pointer_cast<ObjectArray>(ptr)->Read();
     size_t result = 0;
 
     for (auto it = base.begin(); it != base.end(); ++it) {
@@ -122,22 +126,24 @@ namespace kagami {
     return result;
   }
 
-  shared_ptr<void> ArrayDelivery(shared_ptr<void> ptr) {
+  //Elements are copied when shared buffer of array is written for the first
+  //time, instead of when array is assigned.
+  shared_ptr<ArrayBuffer> CloneBuffer(const ArrayBuffer &src) {
     using namespace management::type;
-    auto &src_base = *static_pointer_cast<ObjectArray>(ptr);
-    ManagedArray dest_base = make_shared<ObjectArray>();
+    auto dest = MakePooled<ArrayBuffer>();
 
-    for (auto &unit : src_base) {
-      dest_base->emplace_back(CreateObjectCopy(unit));
+    for (auto &unit : src) {
+      Object temp(unit);
+      dest->emplace_back(CreateObjectCopy(temp));
     }
 
-    return dest_base;
+    return dest;
   }
 
   Message NewPair(ObjectMap &p) {
     auto &left = p["left"];
     auto &right = p["right"];
-    ManagedPair pair = make_shared<ObjectPair>(
+    ManagedPair pair = MakePooled<ObjectPair>(
       management::type::CreateObjectCopy(left),
       management::type::CreateObjectCopy(right));
     return Message().SetObject(Object(pair, kTypeIdPair));
@@ -155,7 +161,7 @@ namespace kagami {
 
   shared_ptr<void> PairDelivery(shared_ptr<void> ptr) {
     auto &src_base = *static_pointer_cast<ObjectPair>(ptr);
-    ManagedPair dest_base = make_shared<ObjectPair>(
+    ManagedPair dest_base = MakePooled<ObjectPair>(
       management::type::CreateObjectCopy(src_base.first),
       management::type::CreateObjectCopy(src_base.second)
       );
@@ -163,13 +169,13 @@ namespace kagami {
   }
 
   Message NewTable(ObjectMap &p) {
-    ManagedTable table = make_shared<ObjectTable>();
+    ManagedTable table = MakePooled<ObjectTable>();
     return Message().SetObject(Object(table, kTypeIdTable));
   }
 
   Message TableInsert(ObjectMap &p) {
     using namespace management::type;
-    auto &table = p.Cast<ObjectTable>(kStrMe);
+    auto &table = p.Cast<ObjectTable>(kStrMe).Write();
     auto &key = p["key"];
     auto &value = p["value"];
     auto result = table.insert(
@@ -179,60 +185,60 @@ namespace kagami {
   }
 
   Message TableGetElement(ObjectMap &p) {
-    auto &table = p.Cast<ObjectTable>(kStrMe);
+    auto &table = p.Cast<ObjectTable>(kStrMe).Leak();
     auto &dest_key = p["key"];
     auto &result = table[dest_key];
     return Message().SetObject(Object().PackObject(result));
   }
 
   Message TableEraseElement(ObjectMap &p) {
-    auto &table = p.Cast<ObjectTable>(kStrMe);
+    auto &table = p.Cast<ObjectTable>(kStrMe).Write();
     auto &key = p["key"];
     auto count = table.erase(key);
     return Message().SetObject(static_cast<int64_t>(count));
   }
 
   Message TableEmpty(ObjectMap &p) {
-    auto &table = p.Cast<ObjectTable>(kStrMe);
+    auto &table = p.Cast<ObjectTable>(kStrMe).Read();
     return Message().SetObject(table.empty());
   }
 
   Message TableSize(ObjectMap &p) {
-    auto &table = p.Cast<ObjectTable>(kStrMe);
+    auto &table = p.Cast<ObjectTable>(kStrMe).Read();
     return Message().SetObject(static_cast<int64_t>(table.size()));
   }
 
   Message TableClear(ObjectMap &p) {
-    auto &table = p.Cast<ObjectTable>(kStrMe);
+    auto &table = p.Cast<ObjectTable>(kStrMe).Write();
     table.clear();
     return Message();
   }
 
+  //Iterator of table unpacks copies of key and value, but head and tail
+  //still must be taken from the same buffer.
   Message TableHead(ObjectMap &p) {
-    auto &table = p.Cast<ObjectTable>(kStrMe);
+    auto &table = p.Cast<ObjectTable>(kStrMe).Leak();
     shared_ptr<UnifiedIterator> it =
-      make_shared<UnifiedIterator>(table.begin(), kContainerObjectTable);
+      MakePooled<UnifiedIterator>(table.begin(), kContainerObjectTable);
     return Message().SetObject(Object(it, kTypeIdIterator));
   }
 
   Message TableTail(ObjectMap &p) {
-    auto &table = p.Cast<ObjectTable>(kStrMe);
+    auto &table = p.Cast<ObjectTable>(kStrMe).Leak();
     shared_ptr<UnifiedIterator> it =
-      make_shared<UnifiedIterator>(table.end(), kContainerObjectTable);
+      MakePooled<UnifiedIterator>(table.end(), kContainerObjectTable);
     return Message().SetObject(Object(it, kTypeIdIterator));
   }
 
-  shared_ptr<void> TableDelivery(shared_ptr<void> ptr) {
+  shared_ptr<TableBuffer> CloneBuffer(const TableBuffer &src) {
     using namespace management::type;
-    auto &table = *static_pointer_cast<ObjectTable>(ptr);
-    ManagedTable dest = make_shared<ObjectTable>();
-    Object key_copy;
+    auto dest = MakePooled<TableBuffer>();
 
-    for (auto &unit : table) {
-      key_copy = unit.first;
+    for (auto &unit : src) {
+      Object key_copy(unit.first), value_copy(unit.second);
       dest->insert(
         std::make_pair(CreateObjectCopy(key_copy), 
-          CreateObjectCopy(unit.second)));
+          CreateObjectCopy(value_copy)));
     }
 
     return dest;
@@ -241,7 +247,7 @@ namespace kagami {
   void InitContainerComponents() {
     using management::type::ObjectTraitsSetup;
 
-    ObjectTraitsSetup(kTypeIdArray, ArrayDelivery, ArrayHasher)
+    ObjectTraitsSetup(kTypeIdArray, PlainDeliveryImpl<ObjectArray>, ArrayHasher)
       .InitConstructor(
         FunctionImpl(NewArray, "size|init_value", "array", kParamAutoFill).SetLimit(0)
       )
@@ -280,7 +286,7 @@ namespace kagami {
         }
     );
 
-    ObjectTraitsSetup(kTypeIdTable, TableDelivery)
+    ObjectTraitsSetup(kTypeIdTable, PlainDeliveryImpl<ObjectTable>)
       .InitConstructor(
         FunctionImpl(NewTable, "", "table")
       )
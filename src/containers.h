@@ -42,33 +42,33 @@ namespace kagami {
 
 
   template <>
-  class BasicIterator<ObjectTable::iterator> : public IteratorInterface {
+  class BasicIterator<TableBuffer::iterator> : public IteratorInterface {
   private:
-    ObjectTable::iterator it_;
+    TableBuffer::iterator it_;
 
   public:
     BasicIterator() = delete;
-    BasicIterator(ObjectTable::iterator it) : it_(it) {}
+    BasicIterator(TableBuffer::iterator it) : it_(it) {}
     BasicIterator(const BasicIterator &rhs) : it_(rhs.it_) {}
     BasicIterator(const BasicIterator &&rhs) : BasicIterator(rhs) {}
 
   public:
     void StepForward() { ++it_; }
     void StepBack() { }
-    ObjectTable::iterator &Get() { return it_; }
+    TableBuffer::iterator &Get() { return it_; }
     Object Unpack() {
       auto copy_left = it_->first;
-      ManagedPair base = make_shared<ObjectPair>(
+      ManagedPair base = MakePooled<ObjectPair>(
         Object(management::type::CreateObjectCopy(copy_left)),
         Object(management::type::CreateObjectCopy(it_->second)));
       return Object(base, kTypeIdPair);
     }
-    bool operator==(BasicIterator<ObjectTable::iterator> &rhs) const 
+    bool operator==(BasicIterator<TableBuffer::iterator> &rhs) const 
     { return it_ == rhs.it_; }
   };
 
-  using ObjectArrayIterator = BasicIterator<ObjectArray::iterator>;
-  using ObjectTableIterator = BasicIterator<ObjectTable::iterator>;
+  using ObjectArrayIterator = BasicIterator<ArrayBuffer::iterator>;
+  using ObjectTableIterator = BasicIterator<TableBuffer::iterator>;
   /*
     Top iterator wrapper.
     Provide unified methods for iterator type in script.
@@ -109,7 +109,7 @@ namespace kagami {
     */
     template <class Tx>
     UnifiedIterator(Tx it, BaseContainerCode type) :
-      it_(dynamic_pointer_cast<IteratorInterface>(make_shared<BasicIterator<Tx>>(it))),
+      it_(dynamic_pointer_cast<IteratorInterface>(MakePooled<BasicIterator<Tx>>(it))),
       container_type_(type) {}
 
     void StepForward() { it_->StepForward(); }
@@ -1,5 +1,11 @@
 #include "filestream.h"
 
+#if not defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 namespace kagami {
   FILE *GetVMStdout(FILE *dest) {
     static FILE *vm_stdout = stdout;
@@ -123,4 +129,88 @@ namespace kagami {
 
     return result;
   }
-}
\ No newline at end of file
+
+  bool MappedFile::ReadBuffer(string path) {
+    FILE *fp = fopen(path.data(), "rb");
+    if (fp == nullptr) return false;
+
+    char buf[65536];
+    size_t count = 0;
+    while ((count = fread(buf, 1, sizeof(buf), fp)) > 0) {
+      buffer_.append(buf, count);
+    }
+
+    fclose(fp);
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    return true;
+  }
+
+#if defined(_WIN32)
+  MappedFile::MappedFile(string path) :
+    data_(nullptr), size_(0), good_(false), mapped_(false), buffer_(),
+    file_(INVALID_HANDLE_VALUE), mapping_(nullptr) {
+    file_ = CreateFileA(path.data(), GENERIC_READ, FILE_SHARE_READ,
+      nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file_, &size) && size.QuadPart == 0) {
+      good_ = true;
+      return;
+    }
+
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ != nullptr) {
+      data_ = static_cast<const char *>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+
+    if (data_ != nullptr) {
+      size_ = static_cast<size_t>(size.QuadPart);
+      good_ = mapped_ = true;
+    }
+    else {
+      good_ = ReadBuffer(path);
+    }
+  }
+
+  MappedFile::~MappedFile() {
+    if (mapped_) UnmapViewOfFile(data_);
+    if (mapping_ != nullptr) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+  }
+#else
+  MappedFile::MappedFile(string path) :
+    data_(nullptr), size_(0), good_(false), mapped_(false), buffer_(),
+    fd_(-1) {
+    fd_ = open(path.data(), O_RDONLY);
+    if (fd_ < 0) return;
+
+    struct stat info;
+    if (fstat(fd_, &info) == 0 && S_ISREG(info.st_mode)) {
+      if (info.st_size == 0) {
+        good_ = true;
+        return;
+      }
+
+      void *ptr = mmap(nullptr, static_cast<size_t>(info.st_size),
+        PROT_READ, MAP_PRIVATE, fd_, 0);
+
+      if (ptr != MAP_FAILED) {
+        data_ = static_cast<const char *>(ptr);
+        size_ = static_cast<size_t>(info.st_size);
+        good_ = mapped_ = true;
+        return;
+      }
+    }
+
+    good_ = ReadBuffer(path);
+  }
+
+  MappedFile::~MappedFile() {
+    if (mapped_) munmap(const_cast<char *>(data_), size_);
+    if (fd_ >= 0) close(fd_);
+  }
+#endif
+}
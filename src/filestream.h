@@ -1,3 +1,4 @@
+#pragma once
 #include "common.h"
 
 namespace kagami {
@@ -105,6 +106,39 @@ namespace kagami {
     bool WriteLine(wstring str);
   };
 
+  /*
+    Read-only view of whole file.
+    File is memory-mapped if possible, otherwise it's read into buffer
+    in one pass.
+  */
+  class MappedFile {
+  private:
+    const char *data_;
+    size_t size_;
+    bool good_;
+    bool mapped_;
+    string buffer_;
+#if defined(_WIN32)
+    HANDLE file_;
+    HANDLE mapping_;
+#else
+    int fd_;
+#endif
+
+    bool ReadBuffer(string path);
+
+  public:
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(string path);
+    ~MappedFile();
+
+    bool Good() const { return good_; }
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+  };
+
   //class FileStreamEx : public BasicStream {
 
   //};
@@ -1,4 +1,6 @@
 #include "frontend.h"
+#include "machine.h"
+#include "codecache.h"
 
 #define ERROR_MSG(_Msg) Message(kCodeBadExpression, _Msg, kStateError)
 
@@ -25,6 +27,33 @@ namespace kagami {
       keyword == kKeywordFor;
   }
 
+  inline bool IsLogicOperator(Keyword keyword) {
+    return keyword == kKeywordEquals ||
+      keyword == kKeywordLessOrEqual ||
+      keyword == kKeywordGreaterOrEqual ||
+      keyword == kKeywordNotEqual ||
+      keyword == kKeywordGreater ||
+      keyword == kKeywordLess ||
+      keyword == kKeywordAnd ||
+      keyword == kKeywordOr;
+  }
+
+  inline bool IsFusibleOperator(Keyword keyword) {
+    return keyword == kKeywordPlus ||
+      keyword == kKeywordMinus ||
+      keyword == kKeywordTimes ||
+      keyword == kKeywordDivide ||
+      IsLogicOperator(keyword);
+  }
+
+  //Command which takes one value from return stack only
+  inline bool IsStackConsumer(Command &command, Keyword keyword) {
+    return command.first.type == kRequestCommand &&
+      command.first.GetKeywordValue() == keyword &&
+      command.second.size() == 1 &&
+      command.second.back().GetType() == kArgumentReturnStack;
+  }
+
   inline bool IsSingleKeyword(Keyword keyword) {
     return keyword == kKeywordEnd ||
       keyword == kKeywordElse ||
@@ -39,19 +68,18 @@ namespace kagami {
     return string();
   }
 
-  string IndentationAndCommentProc(string target) {
-    if (target == "") return "";
-    string data;
+  //Indentation and comment are removed by narrowing view of the line.
+  string_view IndentationAndCommentProc(string_view target) {
+    if (target.empty()) return target;
     char current = 0, last = 0;
     size_t head = 0, tail = 0;
     bool exempt_blank_char = true;
     bool string_processing = false;
-    auto toString = [](char t) ->string {return string().append(1, t); };
+    auto is_blank = [](char t) -> bool { return compare(t, ' ', '\t', '\r', '\n'); };
 
     for (size_t count = 0; count < target.size(); ++count) {
       current = target[count];
-      auto type = util::GetStringType(toString(current));
-      if (type != StringType::kStringTypeBlank && exempt_blank_char) {
+      if (!is_blank(current) && exempt_blank_char) {
         head = count;
         exempt_blank_char = false;
       }
@@ -64,19 +92,26 @@ namespace kagami {
       }
       last = target[count];
     }
-    if (tail > head) data = target.substr(head, tail - head);
-    else data = target.substr(head, target.size() - head);
-    if (data.front() == '#') return "";
 
-    while (!data.empty() &&
-      util::GetStringType(toString(data.back())) == kStringTypeBlank) {
-      data.pop_back();
+    string_view data = tail > head ?
+      target.substr(head, tail - head) :
+      target.substr(head);
+    if (data.front() == '#') return string_view();
+
+    while (!data.empty() && is_blank(data.back())) {
+      data.remove_suffix(1);
     }
     return data;
   }
 
-  void LexicalFactory::Scan(deque<string> &output, string target) {
-    string current_token, temp;
+  /*
+    Tokens are split in one pass. Type of current token is maintained by
+    util::TokenState, so appending a character never rescans the token.
+  */
+  void LexicalFactory::Scan(deque<Token> &output, string_view target) {
+    using util::TokenState;
+    string current_token;
+    TokenState state, probe;
     bool inside_string = false;
     bool leave_string = false;
     bool enter_string = false;
@@ -84,6 +119,17 @@ namespace kagami {
     bool not_escape_char = false;
     char current = 0, next = 0, last = 0;
 
+    auto emit = [&]() -> void {
+      output.emplace_back(Token(std::move(current_token), state.GetType()));
+      current_token.clear();
+      state.Clear();
+    };
+
+    auto append = [&](char c) -> void {
+      current_token.append(1, c);
+      state.Push(c);
+    };
+
     for (size_t idx = 0; idx < target.size(); idx += 1) {
       current = target[idx];
 
@@ -101,77 +147,88 @@ namespace kagami {
       if (not_escape_char) not_escape_char = false;
 
       if (current == '\'' && !escape_flag) {
-        if (!inside_string && util::GetStringType(current_token) == kStringTypeBlank) {
+        if (!inside_string && state.GetType() == kStringTypeBlank) {
           current_token.clear();
+          state.Clear();
         }
 
-        inside_string ?
-          leave_string = true :
-          inside_string = true, enter_string = true;
+        //Closing quote is also classified with token
+        if (inside_string) leave_string = true;
+        else inside_string = true;
+        enter_string = true;
       }
 
       if (!inside_string || enter_string) {
-        temp = current_token;
-        temp.append(1, current);
+        probe = state;
+        probe.Push(current);
 
-        auto type = util::GetStringType(temp);
+        auto type = probe.GetType();
         if (type == kStringTypeNull) {
-          auto type = util::GetStringType(current_token);
-          switch (type) {
+          switch (state.GetType()) {
           case kStringTypeBlank:
             current_token.clear();
-            current_token.append(1, current);
+            state.Clear();
+            append(current);
             break;
           case kStringTypeInt:
             if (current == '.' && util::IsDigit(next)) {
-              current_token.append(1, current);
+              append(current);
             }
             else {
-              output.emplace_back(current_token);
-              current_token.clear();
-              current_token.append(1, current);
+              emit();
+              append(current);
             }
             break;
           default:
-            output.emplace_back(current_token);
-            current_token.clear();
-            current_token.append(1, current);
+            emit();
+            append(current);
             break;
           }
         }
         else {
-          if (type == kStringTypeInt && (temp[0] == '+' || temp[0] == '-')) {
-            output.emplace_back(string().append(1, temp[0]));
-            current_token = temp.substr(1, temp.size() - 1);
+          if (type == kStringTypeInt && !current_token.empty() &&
+            compare(current_token.front(), '+', '-')) {
+            output.emplace_back(Token(string(1, current_token.front()), kStringTypeSymbol));
+            current_token.erase(0, 1);
+            current_token.append(1, current);
+            state.Clear();
+            for (auto &unit : current_token) state.Push(unit);
           }
           else {
-            current_token = temp;
+            append(current);
           }
         }
 
-
         if (enter_string) enter_string = false;
       }
       else {
         if (escape_flag) current = util::GetEscapeChar(current);
         if (current == '\\' && last == '\\') not_escape_char = true;
-        current_token.append(1, current);
+        append(current);
       }
 
       last = target[idx];
     }
 
-    if (util::GetStringType(current_token) != kStringTypeBlank) {
-      output.emplace_back(current_token);
+    if (state.GetType() != kStringTypeBlank) {
+      emit();
     }
+  }
 
+  void LexicalFactory::Report(string detail, StateLevel level) {
+    if (events_ != nullptr) {
+      events_->emplace_back(LexicalEvent(detail, level));
+      return;
+    }
+
+    trace::AddEvent(detail, level);
   }
 
   bool LexicalFactory::Feed(CombinedCodeline &src) {
     bool good = true;
     bool negative_flag = false;
     stack<string> bracket_stack;
-    deque<string> target;
+    deque<Token> target;
     Token current = INVALID_TOKEN;
     Token next = INVALID_TOKEN;
     Token last = INVALID_TOKEN;
@@ -183,21 +240,19 @@ namespace kagami {
     auto *tokens = &dest_->back().second;
 
     for (size_t idx = 0; idx < target.size(); idx += 1) {
-      current = Token(target[idx], util::GetStringType(target[idx]));
-      next = (idx < target.size() - 1) ?
-        Token(target[idx + 1], util::GetStringType(target[idx + 1])) :
-        INVALID_TOKEN;
+      current = target[idx];
+      next = (idx < target.size() - 1) ? target[idx + 1] : INVALID_TOKEN;
 
       if (current.first == ";") {
         if (!bracket_stack.empty()) {
-          trace::AddEvent("Invalid end of statment at line " +
+          Report("Invalid end of statment at line " +
             to_string(src.first), kStateError);
           good = false;
           break;
         }
 
         if (idx == target.size() - 1) {
-          trace::AddEvent("Unnecessary semicolon at line " +
+          Report("Unnecessary semicolon at line " +
             to_string(src.first), kStateWarning);
         }
         else {
@@ -209,7 +264,7 @@ namespace kagami {
       }
 
       if (current.second == kStringTypeNull) {
-        trace::AddEvent("Unknown token - " + current.first +
+        Report("Unknown token - " + current.first +
           " at line " + to_string(src.first), kStateError);
         good = false;
         break;
@@ -231,14 +286,14 @@ namespace kagami {
 
       if (compare(current.first, ")", "]", "}")) {
         if (bracket_stack.empty()) {
-          trace::AddEvent("Left bracket is missing - " + current.first +
+          Report("Left bracket is missing - " + current.first +
             " at line " + to_string(src.first), kStateError);
           good = false;
           break;
         }
 
         if (GetLeftBracket(current.first) != bracket_stack.top()) {
-          trace::AddEvent("Left bracket is missing - " + current.first +
+          Report("Left bracket is missing - " + current.first +
             " at line " + to_string(src.first), kStateError);
           good = false;
           break;
@@ -250,7 +305,7 @@ namespace kagami {
       if (current.first == ",") {
         if (last.second == kStringTypeSymbol &&
           !compare(last.first, "]", ")", "}", "'")) {
-          trace::AddEvent("Invalid comma at line " + to_string(src.first), kStateError);
+          Report("Invalid comma at line " + to_string(src.first), kStateError);
           good = false;
           break;
         }
@@ -714,16 +769,28 @@ namespace kagami {
     return Parse().SetIndex(line.first);
   }
 
-  bool VMCodeFactory::ReadScript(list<CombinedCodeline> &dest) {
+  bool VMCodeFactory::ReadScript(vector<CombinedCodeline> &dest) {
+    MappedFile file(path_);
+
+    if (!file.Good()) return false;
+
+    ReadScript(file, dest);
+    return true;
+  }
+
+  void VMCodeFactory::ReadScript(const MappedFile &file, 
+    vector<CombinedCodeline> &dest) {
     bool inside_comment_block = false;
     size_t idx = 1;
-    string buf;
-    InStream reader(path_);
+    const char *pos = file.data();
+    const char *end = pos + file.size();
 
-    if (!reader.Good()) return false;
+    while (pos != end) {
+      auto *next = static_cast<const char *>(memchr(pos, '\n', end - pos));
+      if (next == nullptr) next = end;
 
-    while (!reader.eof()) {
-      buf = reader.GetLine();
+      string_view buf(pos, next - pos);
+      pos = (next == end) ? end : next + 1;
 
       if (buf == kStrCommentBegin) {
         inside_comment_block = true;
@@ -744,50 +811,510 @@ namespace kagami {
         continue;
       }
 
-      dest.push_back(CombinedCodeline(idx, buf));
+      dest.push_back(CombinedCodeline(idx, string(buf)));
       idx += 1;
     }
+  }
+
+  void VMCodeFactory::RecordOptimization(string name, size_t index) {
+    opt_counter_[name] += 1;
+
+    if (opt_report_) {
+      trace::AddEvent("Optimization at line " + to_string(index) + ": " + name,
+        kStateNormal);
+    }
+  }
+
+  void VMCodeFactory::Fuse(VMCode &line, size_t pos, size_t count, 
+    Command fused, string name, size_t index) {
+    line.erase(line.begin() + pos, line.begin() + pos + count);
+    line.insert(line.begin() + pos, fused);
+    RecordOptimization(name, index);
+  }
+
+  /*
+    Superinstruction fusion pass.
+    It works on the commands of single line before they are appended to
+    destination, so nest/jump records are always built from fused result.
+    - operate-and-bind: (a OP b) -> Bind(x, RS) => Bind(x, a, b)
+    - compare-and-branch: (a OP b) -> [ExpList(RS)] -> If/Elif/While(RS)
+      => If/Elif/While(a, b)
+    The merged operator is recorded in option.fused_op.
+  */
+  void VMCodeFactory::FuseInstructions(VMCode &line, size_t index) {
+    for (size_t pos = 0; pos < line.size(); ++pos) {
+      auto &op = line[pos];
+      auto token = op.first.GetKeywordValue();
+
+      if (op.first.type != kRequestCommand || !IsFusibleOperator(token) ||
+        op.second.size() != 2 || op.first.option.void_call) {
+        continue;
+      }
+
+      size_t next = pos + 1;
+
+      if (next < line.size() && line[next].first.type == kRequestCommand &&
+        line[next].first.GetKeywordValue() == kKeywordBind &&
+        line[next].second.size() == 2 &&
+        line[next].second.back().GetType() == kArgumentReturnStack) {
+        Command fused = line[next];
+        fused.first.option.fused_op = token;
+        fused.second.pop_back();
+        fused.second.insert(fused.second.end(), 
+          op.second.begin(), op.second.end());
+        Fuse(line, pos, 2, fused, "operate-and-bind", index);
+        continue;
+      }
+
+      if (!IsLogicOperator(token)) continue;
+
+      //ExpList only forwards its last argument
+      if (next < line.size() && line[next].first.type == kRequestCommand &&
+        line[next].first.GetKeywordValue() == kKeywordExpList &&
+        !line[next].second.empty() &&
+        line[next].second.back().GetType() == kArgumentReturnStack &&
+        !line[next].first.option.void_call) {
+        next += 1;
+      }
+
+      if (next < line.size() && 
+        (IsStackConsumer(line[next], kKeywordIf) ||
+          IsStackConsumer(line[next], kKeywordElif) ||
+          IsStackConsumer(line[next], kKeywordWhile))) {
+        Command fused = line[next];
+        fused.first.option.fused_op = token;
+        fused.second = op.second;
+        Fuse(line, pos, next - pos + 1, fused, "compare-and-branch", index);
+      }
+    }
+  }
+
+  /*
+    Literal value which is produced by folding. The object is parsed back
+    to make sure that the literal is exactly the same value.
+  */
+  bool MakeLiteral(Object &obj, Argument &dest) {
+    string data;
+    StringType type;
+
+    switch (obj.GetType()) {
+    case kTypeInt: 
+      data = to_string(obj.Cast<int64_t>()); 
+      type = kStringTypeInt; 
+      break;
+    case kTypeFloat: {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%.17g", obj.Cast<double>());
+      data = buf;
+      if (data.find_first_of(".e") == string::npos) data.append(".0");
+      type = kStringTypeFloat;
+      if (!util::IsFloat(data)) return false;
+      break;
+    }
+    case kTypeBool:
+      data = obj.Cast<bool>() ? kStrTrue : kStrFalse;
+      type = kStringTypeBool;
+      break;
+    case kTypeString: {
+      data = "'";
+      for (auto unit : obj.Cast<string>()) {
+        if (unit == '\\') data.append(1, '\\');
+        data.append(1, unit);
+      }
+      data.append("'");
+      type = kStringTypeString;
+      break;
+    }
+    default:
+      return false;
+    }
+
+    Object parsed = ParseLiteral(data, type);
+
+    if (!management::type::CompareObjects(parsed, obj)) return false;
 
+    dest = Argument(data, kArgumentNormal, type);
     return true;
   }
 
+  /*
+    Constant folding pass.
+    Operator with literal (or exported constant) operands is evaluated here,
+    and its result is written into the operand of next command which takes
+    it from return stack. Exported constants are only used when their names
+    are never bound in script. Lines compiled by hot reload are only a part
+    of the script, so names bound elsewhere can't be known and exported
+    constants are not folded there.
+  */
+  void VMCodeFactory::ConstantFolding() {
+    auto &code = *dest_;
+    unordered_map<string, bool> bound_names;
+    vector<bool> removed(code.size(), false);
+
+    for (auto &unit : code) {
+      auto token = unit.first.GetKeywordValue();
+      auto &args = unit.second;
+
+      if (unit.first.type != kRequestCommand) continue;
+
+      if (compare(token, kKeywordFn, kKeywordFor)) {
+        for (auto &arg : args) bound_names[arg.GetData()] = true;
+      }
+      else if (compare(token, kKeywordBind, kKeywordDeliver) && !args.empty()) {
+        bound_names[args[0].GetData()] = true;
+      }
+    }
+
+    auto get_constant = [&](Argument &arg, Object &dest) -> bool {
+      if (arg.GetType() == kArgumentNormal) {
+        if (!compare(arg.GetStringType(), kStringTypeInt, kStringTypeFloat,
+          kStringTypeString, kStringTypeBool)) {
+          return false;
+        }
+
+        dest = ParseLiteral(arg.GetData(), arg.GetStringType());
+        return true;
+      }
+
+      if (arg.GetType() == kArgumentObjectStack && !partial_ &&
+        bound_names.find(arg.GetData()) == bound_names.end()) {
+        dest = management::GetConstantObject(arg.GetData());
+        return !dest.Null() && util::IsPlainType(dest.GetType());
+      }
+
+      return false;
+    };
+
+    auto fold = [&](Keyword op, Argument &lhs, Argument &rhs, Argument &dest) -> bool {
+      Object lhs_obj, rhs_obj, result;
+
+      if (!get_constant(lhs, lhs_obj) || !get_constant(rhs, rhs_obj)) return false;
+      if (!EvaluateConstant(op, lhs_obj, rhs_obj, result)) return false;
+
+      return MakeLiteral(result, dest);
+    };
+
+    //Operand of next command in the same line which takes the value
+    auto find_consumer = [&](size_t idx) -> Argument * {
+      if (idx + 1 >= code.size()) return nullptr;
+
+      auto &next = code[idx + 1];
+      Argument *dest = nullptr;
+      size_t counter = 0;
+
+      if (next.first.idx != code[idx].first.idx) return nullptr;
+
+      if (next.first.GetInterfaceDomain().GetType() == kArgumentReturnStack) {
+        return nullptr;
+      }
+
+      for (auto &arg : next.second) {
+        if (arg.GetType() == kArgumentReturnStack) {
+          dest = &arg;
+          counter += 1;
+        }
+      }
+
+      if (counter != 1) return nullptr;
+
+      //ExpList only takes its last argument
+      if (next.first.type == kRequestCommand && 
+        next.first.GetKeywordValue() == kKeywordExpList &&
+        dest != &next.second.back()) {
+        return nullptr;
+      }
+
+      return dest;
+    };
+
+    for (size_t idx = 0; idx < code.size(); ++idx) {
+      auto &request = code[idx].first;
+      auto &args = code[idx].second;
+      auto token = request.GetKeywordValue();
+      Argument literal;
+
+      if (request.type != kRequestCommand) continue;
+
+      //Superinstruction keeps operands of operator at the tail
+      if (request.option.fused_op != kKeywordNull) {
+        size_t size = args.size();
+        if (size >= 2 && 
+          fold(request.option.fused_op, args[size - 2], args[size - 1], literal)) {
+          args.pop_back();
+          args.back() = literal;
+          request.option.fused_op = kKeywordNull;
+          RecordOptimization("constant-folding", request.idx);
+        }
+
+        continue;
+      }
+
+      if (request.option.void_call) continue;
+
+      Argument *consumer = find_consumer(idx);
+
+      if (consumer == nullptr) continue;
+
+      if (IsFusibleOperator(token) && args.size() == 2 &&
+        fold(token, args[0], args[1], literal)) {
+        *consumer = literal;
+        removed[idx] = true;
+        RecordOptimization("constant-folding", request.idx);
+      }
+      else if (token == kKeywordExpList && !args.empty()) {
+        Object obj;
+        if (get_constant(args.back(), obj) && MakeLiteral(obj, literal)) {
+          *consumer = literal;
+          removed[idx] = true;
+        }
+      }
+    }
+
+    code.Compact(removed);
+  }
+
+  /*
+    Remove if/while block with constant condition.
+    - 'if false' and 'while false' blocks are removed entirely;
+    - 'if true' is unwrapped unless there is break/continue inside, because
+      escape depth counts the nest levels between it and the loop.
+    Blocks with elif/else branches are left to runtime.
+  */
+  void VMCodeFactory::DeadBranchElimination() {
+    auto &code = *dest_;
+    vector<bool> removed(code.size(), false);
+
+    for (size_t idx = 0; idx < code.size(); ++idx) {
+      auto &request = code[idx].first;
+      auto &args = code[idx].second;
+      auto token = request.GetKeywordValue();
+
+      if (removed[idx] || request.type != kRequestCommand) continue;
+      if (!compare(token, kKeywordIf, kKeywordWhile)) continue;
+      if (args.size() != 1 || args[0].GetType() != kArgumentNormal ||
+        args[0].GetStringType() != kStringTypeBool) {
+        continue;
+      }
+
+      //Condition must be the only command of its line
+      if (idx > 0 && code[idx - 1].first.idx == request.idx) continue;
+      if (code.HasJumpRecord(idx)) continue;
+
+      size_t nest_end = request.option.nest_end;
+      bool state = args[0].GetData() == kStrTrue;
+
+      if (nest_end >= code.size() || nest_end <= idx) continue;
+
+      if (!state) {
+        for (size_t pos = idx; pos <= nest_end; ++pos) removed[pos] = true;
+        RecordOptimization("dead-branch", request.idx);
+        idx = nest_end;
+      }
+      else if (token == kKeywordIf) {
+        bool escaper = false;
+
+        for (size_t pos = idx + 1; pos < nest_end; ++pos) {
+          if (compare(code[pos].first.GetKeywordValue(),
+            kKeywordContinue, kKeywordBreak) && 
+            code[pos].first.type == kRequestCommand) {
+            escaper = true;
+            break;
+          }
+        }
+
+        if (escaper) continue;
+
+        removed[idx] = true;
+        removed[nest_end] = true;
+        RecordOptimization("dead-branch", request.idx);
+      }
+    }
+
+    code.Compact(removed);
+  }
+
+  //Lex and parse source lines in [begin, end), without touching the log
+  void VMCodeFactory::ProcessLines(size_t begin, size_t end) {
+    LineParser line_parser;
+    deque<CombinedToken> tokens;
+
+    for (size_t idx = begin; idx < end; ++idx) {
+      auto &fragment = fragments_[idx];
+      LexicalFactory lexer(tokens, fragment.events);
+
+      tokens.clear();
+      fragment.good = lexer.Feed(script_[idx]);
+      if (!fragment.good) continue;
+
+      for (auto &unit : tokens) {
+        //Message is built in place, it's never assigned or copied here
+        auto &statement = fragment.statements.emplace_back(
+          unit.first, line_parser.Make(unit));
+        statement.ast_root = line_parser.GetASTRoot();
+        statement.code.swap(line_parser.GetOutput());
+        line_parser.Clear();
+      }
+    }
+  }
+
+  FrontendWorkers::~FrontendWorkers() {
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      stop_ = true;
+    }
+
+    wake_.notify_all();
+    for (auto &unit : threads_) unit.join();
+  }
+
+  FrontendWorkers &FrontendWorkers::Get() {
+    static FrontendWorkers workers;
+    return workers;
+  }
+
+  void FrontendWorkers::Loop() {
+    std::unique_lock<std::mutex> lock(lock_);
+    size_t seen = 0;
+
+    while (true) {
+      wake_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+      if (stop_) return;
+
+      seen = generation_;
+      //More threads than needed by this job
+      if (taken_ >= requested_) continue;
+
+      taken_ += 1;
+      auto *job = job_;
+      lock.unlock();
+      (*job)();
+      lock.lock();
+
+      pending_ -= 1;
+      if (pending_ == 0) done_.notify_one();
+    }
+  }
+
+  void FrontendWorkers::Run(const std::function<void()> &job, size_t count) {
+    std::lock_guard<std::mutex> run_guard(run_lock_);
+    std::unique_lock<std::mutex> lock(lock_);
+
+    while (threads_.size() < count) {
+      threads_.emplace_back(&FrontendWorkers::Loop, this);
+    }
+
+    job_ = &job;
+    taken_ = 0;
+    requested_ = count;
+    pending_ = count;
+    generation_ += 1;
+    wake_.notify_all();
+    done_.wait(lock, [&]() { return pending_ == 0; });
+    job_ = nullptr;
+  }
+
+  /*
+    Lines are independent from each other before linking, so they are
+    processed by worker threads. Every worker takes next chunk of lines
+    until all chunks are done.
+  */
+  void VMCodeFactory::RunFrontend() {
+    const size_t total = script_.size();
+    const size_t chunk_count = (total + kFrontendChunkSize - 1) / kFrontendChunkSize;
+    size_t worker_count = std::thread::hardware_concurrency();
+
+    fragments_.clear();
+    fragments_.resize(total);
+
+    if (worker_count > chunk_count) worker_count = chunk_count;
+
+    if (worker_count <= 1) {
+      ProcessLines(0, total);
+      return;
+    }
+
+    std::atomic<size_t> next_chunk(0);
+
+    std::function<void()> worker = [&]() -> void {
+      size_t chunk;
+      while ((chunk = next_chunk.fetch_add(1)) < chunk_count) {
+        size_t begin = chunk * kFrontendChunkSize;
+        size_t end = begin + kFrontendChunkSize;
+        ProcessLines(begin, end < total ? end : total);
+      }
+    };
+
+    FrontendWorkers::Get().Run(worker, worker_count);
+  }
+
   bool VMCodeFactory::Start() {
+    //Hash is taken from the same mapping which frontend reads
+    MappedFile file(path_);
+
+    if (!file.Good()) return false;
+
+    uint64_t hash = use_cache_ ? HashScriptContent(file.data(), file.size()) : 0;
+
+    //Frontend is skipped if cached code of same script is found
+    if (use_cache_ && LoadCodeCache(GetCodeCachePath(path_), hash, *dest_)) {
+      dest_->Assemble();
+      return true;
+    }
+
+    ReadScript(file, script_);
+
+    return Compile(use_cache_, hash);
+  }
+
+  bool VMCodeFactory::Start(vector<CombinedCodeline> lines) {
+    script_ = std::move(lines);
+    partial_ = true;
+    return Compile(false, 0);
+  }
+
+  bool VMCodeFactory::Compile(bool save_cache, uint64_t hash) {
     bool good = true;
-    LexicalFactory lexer(tokens_);
-    LineParser line_parser;
-    Message msg;
-    VMCode anchorage;
     StateLevel level;
     Keyword ast_root;
+    VMCode anchorage;
+    vector<StatementFragment *> statements;
 
-    if (!ReadScript(script_)) return false;
+    RunFrontend();
 
-    for (auto it = script_.begin(); it != script_.end(); ++it) {
-      good = lexer.Feed(*it);
+    //Linking: events and code of fragments are taken in source order
+    for (auto &fragment : fragments_) {
+      for (auto &unit : fragment.events) {
+        trace::AddEvent(unit.first, unit.second);
+      }
+
+      good = fragment.good;
       if (!good) break;
+
+      for (auto &unit : fragment.statements) {
+        statements.push_back(&unit);
+      }
     }
 
     if (!good) return false;
 
-    for (auto it = tokens_.begin(); it != tokens_.end(); ++it) {
+    for (auto it = statements.begin(); it != statements.end(); ++it) {
       if (!good) break;
 
-      msg = line_parser.Make(*it);
-
-      level = msg.GetLevel();
-      ast_root = line_parser.GetASTRoot();
+      auto &statement = **it;
+      level = statement.msg.GetLevel();
+      ast_root = statement.ast_root;
 
       if (level == kStateError) {
-        trace::AddEvent(msg);
+        trace::AddEvent(statement.msg);
         good = false;
         continue;
       }
       else if (level == kStateWarning) {
-        trace::AddEvent(msg);
+        trace::AddEvent(statement.msg);
       }
 
-      anchorage.swap(line_parser.GetOutput());
-      line_parser.Clear();
+      anchorage.swap(statement.code);
+      FuseInstructions(anchorage, statement.index);
 
       if (IsNestRoot(ast_root)) {
         if (ast_root == kKeywordIf || ast_root == kKeywordCase) {
@@ -801,7 +1328,7 @@ namespace kagami {
 
         nest_.push(dest_->size());
         nest_end_.push(dest_->size() + anchorage.size() - 1);
-        nest_origin_.push(it->first);
+        nest_origin_.push(statement.index);
         nest_type_.push(ast_root);
         dest_->insert(dest_->end(), anchorage.begin(), anchorage.end());
         anchorage.clear();
@@ -810,7 +1337,8 @@ namespace kagami {
 
       if (IsBranchKeyword(ast_root)) {
         if (jump_stack_.empty()) {
-          trace::AddEvent("Invalid branch keyword at line " + to_string(it->first), kStateError);
+          trace::AddEvent("Invalid branch keyword at line " + to_string(statement.index), kStateError);
+          good = false;
           break;
         }
 
@@ -819,7 +1347,8 @@ namespace kagami {
             jump_stack_.top().jump_record.push_back(dest_->size());
           }
           else {
-            trace::AddEvent("Invalid branch keyword at line " + to_string(it->first));
+            trace::AddEvent("Invalid branch keyword at line " + to_string(statement.index), kStateError);
+            good = false;
             break;
           }
         }
@@ -828,7 +1357,8 @@ namespace kagami {
             jump_stack_.top().jump_record.push_back(dest_->size());
           }
           else {
-            trace::AddEvent("Invalid branch keyword at line " + to_string(it->first), kStateError);
+            trace::AddEvent("Invalid branch keyword at line " + to_string(statement.index), kStateError);
+            good = false;
             break;
           }
         }
@@ -836,7 +1366,8 @@ namespace kagami {
 
       if (ast_root == kKeywordContinue || ast_root == kKeywordBreak) {
         if (cycle_escaper_.empty()) {
-          trace::AddEvent("Invalid cycle escaper at line " + to_string(it->first), kStateError);
+          trace::AddEvent("Invalid cycle escaper at line " + to_string(statement.index), kStateError);
+          good = false;
           break;
         }
 
@@ -845,7 +1376,7 @@ namespace kagami {
 
       if (ast_root == kKeywordEnd) {
         if (nest_type_.empty()) {
-          trace::AddEvent("Invalid 'end' token at line " + to_string(it->first), kStateError);
+          trace::AddEvent("Invalid 'end' token at line " + to_string(statement.index), kStateError);
           good = false;
           break;
         }
@@ -874,12 +1405,36 @@ namespace kagami {
       anchorage.clear();
     }
 
+    statements.clear();
+    fragments_.clear();
+
     if (!nest_.empty()) {
       trace::AddEvent("'end' token is not found for line " + 
         to_string(nest_origin_.top()), kStateError);
       good = false;
     }
 
+    if (good) {
+      ConstantFolding();
+      DeadBranchElimination();
+      dest_->Assemble();
+
+      if (save_cache && !SaveCodeCache(GetCodeCachePath(path_), hash, *dest_)) {
+        trace::AddEvent("Cannot write bytecode cache for " + path_, kStateWarning);
+      }
+    }
+
+    if (opt_report_) {
+      string report;
+      for (auto &unit : opt_counter_) {
+        if (!report.empty()) report.append(", ");
+        report.append(unit.first + " x" + to_string(unit.second));
+      }
+
+      trace::AddEvent("Optimization summary: " + 
+        (report.empty() ? string("none") : report), kStateNormal);
+    }
+
     return good;
   }
 }
@@ -9,15 +9,26 @@
 namespace kagami {
   using CombinedCodeline = pair<size_t, string>;
   using CombinedToken = pair<size_t, deque<Token>>;
+  using LexicalEvent = pair<string, StateLevel>;
+
+  //Source lines taken by frontend worker at a time
+  const size_t kFrontendChunkSize = 256;
 
   class LexicalFactory {
   private:
     deque<CombinedToken> *dest_;
+    deque<LexicalEvent> *events_;
 
-    void Scan(deque<string> &output, string target);
+    void Scan(deque<Token> &output, string_view target);
+    void Report(string detail, StateLevel level);
   public:
     LexicalFactory() = delete;
-    LexicalFactory(deque<CombinedToken> &dest) : dest_(&dest) {}
+    LexicalFactory(deque<CombinedToken> &dest) : 
+      dest_(&dest), events_(nullptr) {}
+
+    //Events are kept in order instead of being written to log directly
+    LexicalFactory(deque<CombinedToken> &dest, deque<LexicalEvent> &events) :
+      dest_(&dest), events_(&events) {}
 
     bool Feed(CombinedCodeline &src);
 
@@ -100,27 +111,103 @@ namespace kagami {
     list<size_t> jump_record;
   };
 
+  struct StatementFragment {
+    size_t index;
+    Keyword ast_root;
+    Message msg;
+    VMCode code;
+
+    StatementFragment(size_t index, Message &&msg) :
+      index(index), ast_root(kKeywordNull), msg(std::move(msg)), code() {}
+  };
+
+  /*
+    Frontend output of one source line. Fragments are produced in parallel,
+    and spliced into final code in source order.
+  */
+  struct LineFragment {
+    bool good;
+    deque<LexicalEvent> events;
+    deque<StatementFragment> statements;
+
+    LineFragment() : good(true), events(), statements() {}
+  };
+
+  /*
+    Worker threads of frontend. Threads are started on first use and kept
+    until exit of process, so every compile reuses the same threads (and
+    the object pools of them). One job runs at a time.
+  */
+  class FrontendWorkers {
+  private:
+    std::mutex run_lock_;
+    std::mutex lock_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    vector<std::thread> threads_;
+    const std::function<void()> *job_;
+    size_t generation_;
+    size_t taken_;
+    size_t requested_;
+    size_t pending_;
+    bool stop_;
+
+    FrontendWorkers() :
+      run_lock_(), lock_(), wake_(), done_(), threads_(), job_(nullptr),
+      generation_(0), taken_(0), requested_(0), pending_(0), stop_(false) {}
+
+    void Loop();
+
+  public:
+    ~FrontendWorkers();
+
+    static FrontendWorkers &Get();
+
+    //Run job on given count of workers, and wait until all of them return.
+    void Run(const std::function<void()> &job, size_t count);
+  };
+
   class VMCodeFactory {
   private:
     VMCode *dest_;
     string path_;
+    bool opt_report_;
+    bool use_cache_;
+    bool partial_;
+    map<string, size_t> opt_counter_;
     stack<size_t> nest_;
     stack<size_t> nest_end_;
     stack<size_t> nest_origin_;
     stack<size_t> cycle_escaper_;
     stack<Keyword> nest_type_;
     stack<JumpListFrame> jump_stack_;
-    list<CombinedCodeline> script_;
-    deque<CombinedToken> tokens_;
+    vector<CombinedCodeline> script_;
+    vector<LineFragment> fragments_;
 
   private:
-    bool ReadScript(list<CombinedCodeline> &dest);
+    void ProcessLines(size_t begin, size_t end);
+    void RunFrontend();
+    bool Compile(bool save_cache, uint64_t hash);
+    void RecordOptimization(string name, size_t index);
+    void FuseInstructions(VMCode &line, size_t index);
+    void Fuse(VMCode &line, size_t pos, size_t count, Command fused,
+      string name, size_t index);
+    void ConstantFolding();
+    void DeadBranchElimination();
 
   public:
     VMCodeFactory() = delete;
-    VMCodeFactory(string path, VMCode &dest) :
-      dest_(&dest), path_(path) {}
+    VMCodeFactory(string path, VMCode &dest, bool opt_report = false,
+      bool use_cache = false) :
+      dest_(&dest), path_(path), opt_report_(opt_report), use_cache_(use_cache),
+      partial_(false) {}
     
+    bool ReadScript(vector<CombinedCodeline> &dest);
+    void ReadScript(const MappedFile &file, vector<CombinedCodeline> &dest);
     bool Start();
+
+    //Compile given lines instead of script file. Cache is not used, and
+    //exported constants are not folded.
+    bool Start(vector<CombinedCodeline> lines);
   };
 }
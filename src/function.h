@@ -17,14 +17,18 @@ namespace kagami {
     Activity GetActivity() const { return activity_; }
   };
 
+  //Function body is assembled before function object is created,
+  //and its run-time state lives with the function object.
   class VMCodeFunction : public _FunctionImpl {
   private:
     VMCode code_;
+    BytecodeState state_;
 
   public:
-    VMCodeFunction(VMCode ir) : code_(ir) {}
+    VMCodeFunction(VMCode ir) : code_(ir), state_(code_.GetBytecode()) {}
 
-    VMCode &GetCode() { return code_; }
+    const VMCode &GetCode() const { return code_; }
+    CodeRecord GetCodeRecord() { return CodeRecord{ &code_, &state_ }; }
   };
 
   enum FunctionImplType {
@@ -96,16 +100,20 @@ namespace kagami {
       return result;
     }
 
-    VMCode &GetCode() {
+    const VMCode &GetCode() {
       return dynamic_pointer_cast<VMCodeFunction>(impl_)->GetCode();
     }
 
+    CodeRecord GetCodeRecord() {
+      return dynamic_pointer_cast<VMCodeFunction>(impl_)->GetCodeRecord();
+    }
+
     bool operator==(FunctionImpl &rhs) const {
       if (&rhs == this) return true;
       return impl_ == rhs.impl_;
     }
 
-    string GetId() const {
+    const string &GetId() const {
       return id_;
     }
 
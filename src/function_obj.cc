@@ -8,11 +8,11 @@ namespace kagami {
 
   Message FunctionGetParameters(ObjectMap &p) {
     auto &impl = p.Cast<FunctionImpl>(kStrMe);
-    shared_ptr<ObjectArray> dest_base = make_shared<ObjectArray>();
+    shared_ptr<ObjectArray> dest_base = MakePooled<ObjectArray>();
     auto origin_vector = impl.GetParameters();
 
     for (auto it = origin_vector.begin(); it != origin_vector.end(); ++it) {
-      dest_base->emplace_back(Object(*it, kTypeIdString));
+      dest_base->Write().emplace_back(Object(*it, kTypeIdString));
     }
 
     return Message().SetObject(Object(dest_base, kTypeIdArray));
@@ -22,10 +22,9 @@ namespace kagami {
     auto &rhs = p[kStrRightHandSide];
     auto &lhs = p[kStrMe].Cast<FunctionImpl>();
 
-    string type_id = rhs.GetTypeId();
     bool result = false;
 
-    if (type_id == kTypeIdFunction) {
+    if (rhs.GetType() == kTypeFunction) {
       auto &rhs_interface = rhs.Cast<FunctionImpl>();
 
       result = (lhs == rhs_interface);
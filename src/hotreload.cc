@@ -0,0 +1,136 @@
+#include "hotreload.h"
+
+namespace kagami {
+  //FNV-1a over text of block, lines are joined by '\n'
+  uint64_t HashBlockText(vector<CombinedCodeline> &lines, size_t begin, size_t end) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t idx = begin; idx <= end; ++idx) {
+      for (auto &unit : lines[idx].second) {
+        hash ^= static_cast<uint8_t>(unit);
+        hash *= 1099511628211ULL;
+      }
+
+      hash ^= static_cast<uint8_t>('\n');
+      hash *= 1099511628211ULL;
+    }
+
+    return hash;
+  }
+
+  HotReloader::HotReloader(string path) :
+    path_(path),
+    last_write_(),
+    last_check_(std::chrono::steady_clock::now()),
+    digests_(),
+    pending_() {
+    std::error_code error;
+    vector<CombinedCodeline> lines;
+    map<string, FunctionBlock> blocks;
+
+    last_write_ = std::filesystem::last_write_time(path_, error);
+
+    if (ReadBlocks(lines, blocks)) {
+      for (auto &unit : blocks) {
+        digests_[unit.first] = unit.second.digest;
+      }
+    }
+  }
+
+  //Find top-level function blocks by first token of every statement.
+  bool HotReloader::ReadBlocks(vector<CombinedCodeline> &lines,
+    map<string, FunctionBlock> &dest) {
+    VMCode placeholder;
+    VMCodeFactory factory(path_, placeholder);
+    deque<CombinedToken> tokens;
+    deque<LexicalEvent> events;
+    size_t depth = 0, begin = 0;
+    string id;
+
+    if (!factory.ReadScript(lines)) return false;
+
+    for (size_t idx = 0; idx < lines.size(); ++idx) {
+      LexicalFactory lexer(tokens, events);
+
+      tokens.clear();
+      events.clear();
+
+      //File may be saved in the middle of editing, just wait for next one.
+      if (!lexer.Feed(lines[idx])) {
+        for (auto &unit : events) trace::AddEvent(unit.first, unit.second);
+        return false;
+      }
+
+      for (auto &unit : tokens) {
+        if (unit.second.empty()) continue;
+
+        auto &head = unit.second.front().first;
+
+        if (head == "fn") {
+          if (depth == 0 && unit.second.size() > 1) {
+            begin = idx;
+            id = unit.second[1].first;
+          }
+
+          depth += 1;
+        }
+        else if (compare(head, "if", "while", "for", "case")) {
+          depth += 1;
+        }
+        else if (head == "end" && depth > 0) {
+          depth -= 1;
+
+          if (depth == 0 && !id.empty()) {
+            dest[id] = FunctionBlock{ begin, idx, HashBlockText(lines, begin, idx) };
+            id.clear();
+          }
+        }
+      }
+    }
+
+    return true;
+  }
+
+  bool HotReloader::Poll() {
+    using namespace std::chrono;
+    auto now = steady_clock::now();
+
+    if (duration_cast<milliseconds>(now - last_check_).count() < kReloadInterval) {
+      return !pending_.empty();
+    }
+
+    last_check_ = now;
+
+    std::error_code error;
+    auto write_time = std::filesystem::last_write_time(path_, error);
+
+    if (error || write_time == last_write_) return !pending_.empty();
+
+    last_write_ = write_time;
+
+    vector<CombinedCodeline> lines;
+    map<string, FunctionBlock> blocks;
+
+    if (!ReadBlocks(lines, blocks)) return !pending_.empty();
+
+    for (auto &unit : blocks) {
+      auto &block = unit.second;
+      auto it = digests_.find(unit.first);
+
+      if (it != digests_.end() && it->second == block.digest) continue;
+
+      auto code = make_shared<VMCode>();
+      VMCodeFactory factory(path_, *code);
+      vector<CombinedCodeline> block_lines(
+        lines.begin() + block.begin, lines.begin() + block.end + 1);
+
+      //Error of block is reported by frontend, old function is kept.
+      if (!factory.Start(block_lines)) continue;
+
+      digests_[unit.first] = block.digest;
+      pending_.push_back(ReloadUnit{ unit.first, code });
+    }
+
+    return !pending_.empty();
+  }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <chrono>
+#include "frontend.h"
+
+namespace kagami {
+  //Main loop ticks between two checks of script file
+  const size_t kReloadPollStride = 4096;
+  //Minimal interval of checking script file in milliseconds
+  const int64_t kReloadInterval = 100;
+
+  struct FunctionBlock {
+    size_t begin;
+    size_t end;
+    uint64_t digest;
+  };
+
+  struct ReloadUnit {
+    string id;
+    shared_ptr<VMCode> code;
+  };
+
+  /*
+    Watcher of script file for hot reloading.
+    Text of every top-level 'fn ... end' block is remembered, and only blocks
+    changed since last check are compiled again. Compiled blocks are kept in
+    pending list until machine reaches a safe point to swap them in.
+  */
+  class HotReloader {
+  private:
+    string path_;
+    std::filesystem::file_time_type last_write_;
+    std::chrono::steady_clock::time_point last_check_;
+    map<string, uint64_t> digests_;
+    deque<ReloadUnit> pending_;
+
+    bool ReadBlocks(vector<CombinedCodeline> &lines,
+      map<string, FunctionBlock> &dest);
+
+  public:
+    HotReloader() = delete;
+    HotReloader(string path);
+
+    bool Poll();
+    deque<ReloadUnit> &GetPending() { return pending_; }
+  };
+}
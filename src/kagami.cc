@@ -1,4 +1,4 @@
-#include "machine.h"
+#include "libkagami.h"
 #include "argument.h"
 
 using namespace std;
@@ -11,41 +11,53 @@ using Processor = ArgumentProcessor<kHeadHorizon, kJoinerEqual>;
 namespace runtime {
   // Binary name from command line
   static string binary_name;
-
-  // Load add built-in components
-  void InitEmbeddedComponents() {
-    InitPlainTypes();
-    InitConsoleComponents();
-    InitBaseTypes();
-    InitContainerComponents();
-    InitFunctionType();
-    InitStreamComponents();
-#if not defined(_DISABLE_SDL_)
-    InitSoundComponents();
-    InitWindowComponents();
-#endif
-  }
 }
 
-void StartInterpreter_Kisaragi(string path, string log_path, bool real_time_log) {
+void StartInterpreter_Kisaragi(string path, string log_path, bool real_time_log,
+  bool opt_report, string profile_path, bool stats, bool use_cache, bool watch) {
   Agent *agent = real_time_log ?
     static_cast<Agent *>(new StandardRealTimeAgent(log_path.data(), "a+")) :
     static_cast<Agent *>(new StandardCacheAgent(log_path.data(), "a+"));
 
-  trace::InitLoggerSession(agent);
+  InitRuntime(agent);
   trace::AddEvent("Script:" + path);
 
   DEBUG_EVENT("Your're running a copy of Kagami interpreter with debug flag!");
 
-  VMCode script;
-  VMCodeFactory factory(path, script);
+  CompiledScript script(path, opt_report, use_cache);
+
+  if (script.Good()) {
+    Instance main_thread(script);
+    main_thread.SetStats(stats);
+    unique_ptr<Profiler> profiler;
+    unique_ptr<HotReloader> reloader;
+
+    if (!profile_path.empty()) {
+      profiler = make_unique<Profiler>();
+      main_thread.SetProfiler(profiler.get());
+    }
+
+    if (watch) {
+      reloader = make_unique<HotReloader>(path);
+      main_thread.SetReloader(reloader.get());
+    }
 
-  if (factory.Start()) {
-    Machine main_thread(script);
     main_thread.Run();
+
+    if (profiler != nullptr && !profiler->Report(profile_path)) {
+      trace::AddEvent("Cannot write profile report to " + profile_path, 
+        kStateError);
+    }
+  }
+
+  if (stats) {
+    for (auto &unit : CollectRuntimeStats()) {
+      trace::AddEvent("Runtime statistics: " + unit.first + " = " + 
+        to_string(unit.second));
+    }
   }
 
-  trace::StopLoggerSession();
+  StopRuntime();
   delete agent;
 }
 
@@ -67,10 +79,22 @@ void HelpFile() {
     "\tvm_stdout=FILE      Redirection of script standard output.\n"
     "\tvm_stdin=FILE       Redirection of script standard input.\n"
     "\trtlog               Enable real-time logger\n"
+    "\topt_report          Write report of bytecode optimization to log.\n"
+    "\tcache               Load/store compiled script in FILE.kbc next to script.\n"
+    "\twatch               Reload changed functions while script is running.\n"
+    "\tstats               Write runtime statistics to log at exit.\n"
+    "\tprofile=FILE        Write line/function profile to FILE and folded stacks\n"
+    "\t                    to FILE.folded.\n"
     "\twait                Automatically pause at application exit.\n"
     "\thelp                Show this message.\n"
     "\tversion             Show version message of interpreter.\n"
   );
+#if not defined(_DISABLE_SDL_)
+  printf(
+    "\tevent_interval=N    Pump window events every N ticks.(default=256)\n"
+    "\tevent_budget=MS     Pump window events after MS milliseconds.(default=8)\n"
+  );
+#endif
 }
 
 void Motto() {
@@ -109,10 +133,27 @@ void Processing(Processor &processor) {
       GetVMStdin(fopen(vm_stdin.data(), "r"));
     }
 
+#if not defined(_DISABLE_SDL_)
+    if (processor.Exist("event_interval")) {
+      GetEventPumpOption().interval = 
+        static_cast<size_t>(stoul(processor.ValueOf("event_interval")));
+    }
+
+    if (processor.Exist("event_budget")) {
+      GetEventPumpOption().budget = 
+        static_cast<Uint32>(stoul(processor.ValueOf("event_budget")));
+    }
+#endif
+
     setlocale(LC_ALL, processor.Exist("locale") ?
       processor.ValueOf("locale").data() : "en_US.UTF8");
 
-    StartInterpreter_Kisaragi(path, log, processor.Exist("rtlog"));
+    StartInterpreter_Kisaragi(path, log, processor.Exist("rtlog"),
+      processor.Exist("opt_report"),
+      processor.Exist("profile") ? processor.ValueOf("profile") : string(),
+      processor.Exist("stats"),
+      processor.Exist("cache"),
+      processor.Exist("watch"));
     CloseStream();
   }
   else if (processor.Exist("help")) {
@@ -128,7 +169,7 @@ void Processing(Processor &processor) {
 
 int main(int argc, char **argv) {
   runtime::binary_name = argv[0];
-  runtime::InitEmbeddedComponents();
+  InitEmbeddedComponents();
 
   Processor processor = {
     Pattern("script" , Option(true, false, 1)),
@@ -136,11 +177,20 @@ int main(int argc, char **argv) {
     Pattern("version", Option(false, false, 1)),
     Pattern("motto"  , Option(false, false, 1)),
     Pattern("rtlog"  , Option(false, true)),
+    Pattern("opt_report", Option(false, true)),
+    Pattern("profile", Option(true, true)),
+    Pattern("stats"  , Option(false, true)),
+    Pattern("cache"  , Option(false, true)),
+    Pattern("watch"  , Option(false, true)),
     Pattern("log"    , Option(true, true)),
     Pattern("wait"   , Option(false, true)),
     Pattern("locale" , Option(true, true)),
     Pattern("vm_stdout" ,Option(true, true)),
-    Pattern("vm_stdin"  ,Option(true, true))
+    Pattern("vm_stdin"  ,Option(true, true)),
+#if not defined(_DISABLE_SDL_)
+    Pattern("event_interval", Option(true, true)),
+    Pattern("event_budget"  , Option(true, true)),
+#endif
   };
 
 #if not defined(_DISABLE_SDL_)
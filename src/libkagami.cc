@@ -0,0 +1,56 @@
+#include "libkagami.h"
+
+namespace kagami {
+  // Load add built-in components
+  void InitEmbeddedComponents() {
+    static bool initialized = false;
+
+    if (initialized) return;
+
+    InitPlainTypes();
+    InitConsoleComponents();
+    InitBaseTypes();
+    InitContainerComponents();
+    InitFunctionType();
+    InitStreamComponents();
+#if not defined(_DISABLE_SDL_)
+    InitSoundComponents();
+    InitWindowComponents();
+#endif
+    initialized = true;
+  }
+
+  void InitRuntime(Agent *agent) {
+    InitEmbeddedComponents();
+    trace::InitLoggerSession(agent);
+  }
+
+  void StopRuntime() {
+    trace::StopLoggerSession();
+  }
+
+  CompiledScript::CompiledScript(string path, bool opt_report, bool use_cache) :
+    code_(make_shared<VMCode>()), path_(path), good_(false) {
+    VMCodeFactory factory(path, *code_, opt_report, use_cache);
+    good_ = factory.Start();
+  }
+
+  bool Instance::Run() {
+    if (code_ == nullptr) return false;
+
+    Machine machine(*code_);
+    machine.SetDispatchMode(dispatch_);
+    machine.SetProfiler(profiler_);
+    machine.SetReloader(reloader_);
+    machine.SetStats(stats_);
+    machine.SetHostMap(&globals_);
+    machine.Run();
+    error_ = machine.HasError();
+    return !error_;
+  }
+
+  Object Instance::GetResult(string id) {
+    auto it = globals_.find(id);
+    return it != globals_.end() ? it->second : Object();
+  }
+}
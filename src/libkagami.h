@@ -0,0 +1,85 @@
+#pragma once
+/*
+   Embedding interface of Kagami Project
+   Script is compiled once into CompiledScript. Every Instance shares the
+   compiled code and runs it on a machine of its own, which keeps run-time
+   state of the code.
+*/
+#include "machine.h"
+
+namespace kagami {
+  void InitEmbeddedComponents();
+  void InitRuntime(Agent *agent);
+  void StopRuntime();
+
+  class CompiledScript {
+  private:
+    shared_ptr<VMCode> code_;
+    string path_;
+    bool good_;
+
+  public:
+    CompiledScript() : code_(), path_(), good_(false) {}
+
+    CompiledScript(string path, bool opt_report = false, bool use_cache = false);
+
+    bool Good() const { return good_; }
+    string GetPath() const { return path_; }
+    shared_ptr<const VMCode> GetCode() const { return code_; }
+  };
+
+  class Instance {
+  private:
+    shared_ptr<const VMCode> code_;
+    ObjectMap globals_;
+    DispatchMode dispatch_;
+    Profiler *profiler_;
+    HotReloader *reloader_;
+    bool stats_;
+    bool error_;
+
+  public:
+    Instance() = delete;
+
+    Instance(const CompiledScript &script) :
+      code_(script.GetCode()),
+      globals_(),
+      dispatch_(kDefaultDispatchMode),
+      profiler_(nullptr),
+      reloader_(nullptr),
+      stats_(false),
+      error_(false) {}
+
+    Instance &SetArgument(string id, Object obj) {
+      globals_[id] = obj;
+      return *this;
+    }
+
+    Instance &SetDispatchMode(DispatchMode mode) {
+      dispatch_ = mode;
+      return *this;
+    }
+
+    Instance &SetProfiler(Profiler *profiler) {
+      profiler_ = profiler;
+      return *this;
+    }
+
+    Instance &SetReloader(HotReloader *reloader) {
+      reloader_ = reloader;
+      return *this;
+    }
+
+    Instance &SetStats(bool collect) {
+      stats_ = collect;
+      return *this;
+    }
+
+    bool Run();
+
+    bool HasResult(string id) { return globals_.find(id) != globals_.end(); }
+    Object GetResult(string id);
+    ObjectMap &GetGlobals() { return globals_; }
+    bool HasError() const { return error_; }
+  };
+}
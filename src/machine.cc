@@ -5,26 +5,30 @@
 namespace kagami {
   using namespace management;
 
-  PlainType FindTypeCode(string type_id) {
+  PlainType FindTypeCode(TypeId type_id) {
     PlainType type = kNotPlainType;
 
-    if (type_id == kTypeIdInt) type = kPlainInt;
-    if (type_id == kTypeIdFloat) type = kPlainFloat;
-    if (type_id == kTypeIdString) type = kPlainString;
-    if (type_id == kTypeIdBool) type = kPlainBool;
+    switch (type_id) {
+    case kTypeInt:type = kPlainInt; break;
+    case kTypeFloat:type = kPlainFloat; break;
+    case kTypeString:type = kPlainString; break;
+    case kTypeBool:type = kPlainBool; break;
+    default:break;
+    }
 
     return type;
   }
 
-  bool IsIllegalStringOperator(Keyword keyword) {
-    return keyword != kKeywordPlus && 
-      keyword != kKeywordNotEqual && 
-      keyword != kKeywordEquals;
-  }
-
   int64_t IntProducer(Object &obj) {
+    switch (obj.GetScalarTag()) {
+    case kScalarInt:return obj.Cast<int64_t>();
+    case kScalarFloat:return static_cast<int64_t>(obj.Cast<double>());
+    case kScalarBool:return obj.Cast<bool>() ? 1 : 0;
+    default:break;
+    }
+
     int64_t result = 0;
-    switch (auto type = FindTypeCode(obj.GetTypeId()); type) {
+    switch (auto type = FindTypeCode(obj.GetType()); type) {
     case kPlainInt:result = obj.Cast<int64_t>(); break;
     case kPlainFloat:result = static_cast<int64_t>(obj.Cast<double>()); break;
     case kPlainBool:result = obj.Cast<bool>() ? 1 : 0; break;
@@ -35,8 +39,15 @@ namespace kagami {
   }
 
   double FloatProducer(Object &obj) {
+    switch (obj.GetScalarTag()) {
+    case kScalarFloat:return obj.Cast<double>();
+    case kScalarInt:return static_cast<double>(obj.Cast<int64_t>());
+    case kScalarBool:return obj.Cast<bool>() ? 1.0 : 0.0;
+    default:break;
+    }
+
     double result = 0;
-    switch (auto type = FindTypeCode(obj.GetTypeId()); type) {
+    switch (auto type = FindTypeCode(obj.GetType()); type) {
     case kPlainFloat:result = obj.Cast<double>(); break;
     case kPlainInt:result = static_cast<double>(obj.Cast<int64_t>()); break;
     case kPlainBool:result = obj.Cast<bool>() ? 1.0 : 0.0; break;
@@ -48,7 +59,7 @@ namespace kagami {
 
   string StringProducer(Object &obj) {
     string result;
-    switch (auto type = FindTypeCode(obj.GetTypeId()); type) {
+    switch (auto type = FindTypeCode(obj.GetType()); type) {
     case kPlainInt:result = to_string(obj.Cast<int64_t>()); break;
     case kPlainFloat:result = to_string(obj.Cast<double>()); break;
     case kPlainBool:result = obj.Cast<bool>() ? kStrTrue : kStrFalse; break;
@@ -60,7 +71,14 @@ namespace kagami {
   }
 
   bool BoolProducer(Object &obj) {
-    auto type = FindTypeCode(obj.GetTypeId());
+    switch (obj.GetScalarTag()) {
+    case kScalarInt:return obj.Cast<int64_t>() > 0;
+    case kScalarFloat:return obj.Cast<double>() > 0.0;
+    case kScalarBool:return obj.Cast<bool>();
+    default:break;
+    }
+
+    auto type = FindTypeCode(obj.GetType());
     bool result = false;
 
     if (type == kPlainInt) {
@@ -160,15 +178,16 @@ namespace kagami {
   }
 
   void Machine::RecoverLastState() {
+    if (profiler_ != nullptr) profiler_->Exit();
     frame_stack_.pop();
     code_stack_.pop_back();
     obj_stack_.Pop();
   }
 
-  bool Machine::IsTailRecursion(size_t idx, VMCode *code) {
-    if (code != code_stack_.back()) return false;
+  bool Machine::IsTailRecursion(size_t idx, VMCodePointer code) {
+    if (code != code_stack_.back().code) return false;
 
-    auto &vmcode = *code;
+    auto &vmcode = code->GetBytecode();
     auto &current = vmcode[idx];
     bool result = false;
 
@@ -176,11 +195,12 @@ namespace kagami {
       result = true;
     }
     else if (idx == vmcode.size() - 2) {
+      auto &next = vmcode[idx + 1];
       bool needed_by_next_call =
-        vmcode[idx + 1].first.GetKeywordValue() == kKeywordReturn &&
-        vmcode[idx + 1].second.back().GetType() == kArgumentReturnStack &&
-        vmcode[idx + 1].second.size() == 1;
-      if (!current.first.option.void_call && needed_by_next_call) {
+        next.GetKeywordValue() == kKeywordReturn &&
+        next.argc == 1 &&
+        vmcode.GetOperands(next).back().GetType() == kArgumentReturnStack;
+      if (!current.IsVoidCall() && needed_by_next_call) {
         result = true;
       }
     }
@@ -190,18 +210,19 @@ namespace kagami {
 
   bool Machine::IsTailCall(size_t idx) {
     if (frame_stack_.size() <= 1) return false;
-    auto &vmcode = *code_stack_.back();
+    auto &vmcode = GetCurrentBytecode();
     bool result = false;
 
     if (idx == vmcode.size() - 1) {
       result = true;
     }
     else if (idx == vmcode.size() - 2) {
+      auto &next = vmcode[idx + 1];
       bool needed_by_next_call = 
-        vmcode[idx + 1].first.GetKeywordValue() == kKeywordReturn &&
-        vmcode[idx + 1].second.back().GetType() == kArgumentReturnStack &&
-        vmcode[idx + 1].second.size() == 1;
-      if (!vmcode[idx].first.option.void_call && needed_by_next_call) {
+        next.GetKeywordValue() == kKeywordReturn &&
+        next.argc == 1 &&
+        vmcode.GetOperands(next).back().GetType() == kArgumentReturnStack;
+      if (!vmcode[idx].IsVoidCall() && needed_by_next_call) {
         result = true;
       }
     }
@@ -209,58 +230,24 @@ namespace kagami {
     return result;
   }
 
-  Object Machine::FetchPlainObject(Argument &arg) {
-    auto type = arg.GetStringType();
-    auto value = arg.GetData();
-    Object obj;
-
-    if (type == kStringTypeInt) {
-      int64_t int_value;
-      from_chars(value.data(), value.data() + value.size(), int_value);
-      obj.PackContent(make_shared<int64_t>(int_value), kTypeIdInt);
-    }
-    else if (type == kStringTypeFloat) {
-      double float_value;
-#if not defined (_MSC_VER)
-      float_value = stod(value);
-#else
-      from_chars(value.data(), value.data() + value.size(), float_value);
-#endif
-      obj.PackContent(make_shared<double>(float_value), kTypeIdFloat);
-    }
-    else {
-      switch (type) {
-      case kStringTypeBool:
-        obj.PackContent(make_shared<bool>(value == kStrTrue), kTypeIdBool);
-        break;
-      case kStringTypeString:
-        obj.PackContent(make_shared<string>(ParseRawString(value)), kTypeIdString);
-        break;
-      case kStringTypeIdentifier:
-        obj.PackContent(make_shared<string>(value), kTypeIdString);
-        break;
-      default:
-        break;
-      }
-    }
-
-    return obj;
+  Object Machine::FetchPlainObject(const Operand &arg) {
+    return GetCurrentBytecode().GetConstant(arg.index);
   }
 
-  Object Machine::FetchFunctionObject(string id) {
+  Object Machine::FetchFunctionObject(const string &id) {
     Object obj;
     auto &frame = frame_stack_.top();
     auto ptr = FindFunction(id);
 
     if (ptr != nullptr) {
       auto impl = *ptr;
-      obj.PackContent(make_shared<FunctionImpl>(impl), kTypeIdFunction);
+      obj.PackContent(MakePooled<FunctionImpl>(impl), kTypeIdFunction);
     }
 
     return obj;
   }
 
-  Object Machine::FetchObject(Argument &arg, bool checking) {
+  Object Machine::FetchObject(const Operand &arg, bool checking) {
     if (arg.GetType() == kArgumentNormal) {
       return FetchPlainObject(arg).SetDeliverFlag();
     }
@@ -271,17 +258,23 @@ namespace kagami {
     Object obj;
 
     if (arg.GetType() == kArgumentObjectStack) {
-      if (ptr = obj_stack_.Find(arg.GetData()); ptr != nullptr) {
+      auto &id = GetCurrentBytecode().GetName(arg.index);
+
+      if (arg.HasSlot()) ptr = frame.slots[arg.slot];
+
+      if (ptr == nullptr) ptr = obj_stack_.Find(id);
+
+      if (ptr != nullptr) {
         obj.PackObject(*ptr);
         return obj;
       }
 
-      if (obj = GetConstantObject(arg.GetData()); obj.Null()) {
-        obj = FetchFunctionObject(arg.GetData());
+      if (obj = GetConstantObject(id); obj.Null()) {
+        obj = FetchFunctionObject(id);
       }
 
       if (obj.Null()) {
-        frame.MakeError("Object is not found - " + arg.GetData());
+        frame.MakeError("Object is not found - " + id);
       }
     }
     else if (arg.GetType() == kArgumentReturnStack) {
@@ -298,7 +291,30 @@ namespace kagami {
     return obj;
   }
 
-  bool Machine::_FetchFunctionImpl(FunctionImplPointer &impl, string id, string type_id) {
+  //Bind slots to objects which are already in outermost scope of the frame
+  void Machine::LoadSlots() {
+    auto &frame = frame_stack_.top();
+    auto &bytecode = GetCurrentBytecode();
+    auto &base = obj_stack_.GetCurrent();
+
+    frame.scope_base = &base;
+    frame.slots.assign(bytecode.GetSlotCount(), nullptr);
+
+    for (auto &unit : base.GetContent()) {
+      auto slot = bytecode.FindSlot(unit.first);
+      if (slot != kNullSlot) frame.slots[slot] = &unit.second;
+    }
+  }
+
+  void Machine::BindSlot(const Operand &arg, const string &id) {
+    auto &frame = frame_stack_.top();
+
+    if (arg.HasSlot() && &obj_stack_.GetCurrent() == frame.scope_base) {
+      frame.slots[arg.slot] = obj_stack_.GetCurrent().Find(id, false);
+    }
+  }
+
+  bool Machine::_FetchFunctionImpl(FunctionImplPointer &impl, const string &id, const string &type_id) {
     auto &frame = frame_stack_.top();
 
     //Modified version for function invoking
@@ -313,7 +329,7 @@ namespace kagami {
     else {
       if (impl = FindFunction(id); impl != nullptr) return true;
       ObjectPointer ptr = obj_stack_.Find(id);
-      if (ptr != nullptr && ptr->GetTypeId() == kTypeIdFunction) {
+      if (ptr != nullptr && ptr->GetType() == kTypeFunction) {
         impl = &ptr->Cast<FunctionImpl>();
         return true;
       }
@@ -324,11 +340,13 @@ namespace kagami {
     return false;
   }
 
-  bool Machine::FetchFunctionImpl(FunctionImplPointer &impl, CommandPointer &command, ObjectMap &obj_map) {
+  bool Machine::FetchFunctionImpl(FunctionImplPointer &impl, const Instruction &inst, ObjectMap &obj_map) {
     auto &frame = frame_stack_.top();
-    auto id = command->first.GetInterfaceId();
-    auto domain = command->first.GetInterfaceDomain();
-    
+    auto &bytecode = GetCurrentBytecode();
+    auto &id = bytecode.GetName(inst.interface_id);
+    auto &domain = inst.domain;
+    auto &cache = GetCurrentState().GetCallCache(inst);
+    auto epoch = management::GetImplEpoch();
 
     //Object methods.
     //In current developing processing, machine forced to querying built-in
@@ -339,7 +357,12 @@ namespace kagami {
 
       if (frame.error) return false;
 
-      if (impl = FindFunction(id, obj.GetTypeId()); impl == nullptr) {
+      if (!cache.Find(obj.GetType(), epoch, impl)) {
+        impl = FindFunction(id, obj.GetTypeId());
+        cache.Add(obj.GetType(), epoch, impl);
+      }
+
+      if (impl == nullptr) {
         frame.MakeError("Method is not found - " + id);
         return false;
       }
@@ -350,12 +373,28 @@ namespace kagami {
     //Plain bulit-in function and user-defined function
     //At first, Machine will querying in built-in function map,
     //and then try to fetch function object in heap.
+    //Only result of built-in function map is cached. User-defined function
+    //is resolved by dynamic scope: same call site may see different function
+    //objects depending on caller, and scope containers are recycled, so
+    //neither name nor container identifies the result. It is fetched from
+    //frame slot (O(1) for names bound in base scope of frame) or object
+    //stack every time. Caching it would need a binding epoch bumped by every
+    //creation, rebinding and disposal of function objects and by popping of
+    //scopes which hold them.
     else {
-      if (impl = FindFunction(id); impl != nullptr) return true;
+      if (!cache.Find(kTypeNull, epoch, impl)) {
+        impl = FindFunction(id);
+        cache.Add(kTypeNull, epoch, impl);
+      }
 
-      ObjectPointer ptr = obj_stack_.Find(id);
+      if (impl != nullptr) return true;
+
+      ObjectPointer ptr = inst.interface_slot != kNullSlot ?
+        frame.slots[inst.interface_slot] : nullptr;
 
-      if (ptr != nullptr && ptr->GetTypeId() == kTypeIdFunction) {
+      if (ptr == nullptr) ptr = obj_stack_.Find(id);
+
+      if (ptr != nullptr && ptr->GetType() == kTypeFunction) {
         impl = &ptr->Cast<FunctionImpl>();
         return true;
       }
@@ -366,11 +405,14 @@ namespace kagami {
     return false;
   }
 
-  void Machine::ClosureCatching(ArgumentList &args, size_t nest_end, bool closure) {
+  void Machine::ClosureCatching(OperandList &args, size_t nest_end, bool closure) {
     auto &frame = frame_stack_.top();
     auto &obj_list = obj_stack_.GetBase();
-    auto &origin_code = *code_stack_.back();
+    auto &origin_code = *code_stack_.back().code;
+    auto &bytecode = origin_code.GetBytecode();
+    auto &func_id = bytecode.GetIdentifier(args[0]);
     size_t counter = 0, size = args.size(), nest = frame.idx;
+    size_t offset = frame.jump_offset + nest + 1;
     bool optional = false, variable = false;
     ParameterPattern argument_mode = kParamNormal;
     vector<string> params;
@@ -380,8 +422,10 @@ namespace kagami {
       code.push_back(origin_code[idx]);
     }
 
+    code.Assemble(offset);
+
     for (size_t idx = 1; idx < size; idx += 1) {
-      auto id = args[idx].GetData();
+      auto &id = bytecode.GetIdentifier(args[idx]);
 
       if (id == kStrOptional) {
         optional = true;
@@ -405,7 +449,7 @@ namespace kagami {
         continue;
       }
 
-      if (optional && args[idx - 1].GetData() != kStrOptional) {
+      if (optional && bytecode.GetIdentifier(args[idx - 1]) != kStrOptional) {
         frame.MakeError("Optional parameter must be defined after normal parameters");
       }
 
@@ -420,7 +464,7 @@ namespace kagami {
     if (optional) argument_mode = kParamAutoFill;
     if (variable) argument_mode = kParamAutoSize;
 
-    FunctionImpl impl(nest + 1, code, args[0].GetData(), params, argument_mode);
+    FunctionImpl impl(offset, code, func_id, params, argument_mode);
 
     if (optional) {
       impl.SetLimit(params.size() - counter);
@@ -448,12 +492,82 @@ namespace kagami {
       impl.SetClosureRecord(scope_record);
     }
 
-    obj_stack_.CreateObject(args[0].GetData(),
-      Object(make_shared<FunctionImpl>(impl), kTypeIdFunction));
+    obj_stack_.CreateObject(func_id,
+      Object(MakePooled<FunctionImpl>(impl), kTypeIdFunction));
+    BindSlot(args[0], func_id);
 
     frame.Goto(nest_end + 1);
   }
 
+  /*
+    Swap recompiled functions into root scope. It's only called when no user
+    function is running, so that no frame is referring to old code.
+    Definition is executed in a temporary frame and scope, and result is
+    assigned to existing function object, then every copy of it sees new body.
+  */
+  void Machine::ApplyReload() {
+    auto &pending = reloader_->GetPending();
+    auto *root = frame_stack_.top().scope_base;
+
+    for (auto &unit : pending) {
+      auto &code = *unit.code;
+
+      if (code.empty() || code[0].first.type != kRequestCommand ||
+        code[0].first.GetKeywordValue() != kKeywordFn) continue;
+
+      auto &bytecode = code.GetBytecode();
+      auto &inst = bytecode[0];
+      auto args = bytecode.GetOperands(inst);
+      BytecodeState state(bytecode);
+
+      code_stack_.push_back(CodeRecord{ &code, &state });
+      frame_stack_.emplace();
+      obj_stack_.Push();
+
+      ClosureCatching(args, inst.nest_end, false);
+
+      bool error = frame_stack_.top().error;
+      string msg_string = frame_stack_.top().msg_string;
+      ObjectPointer ptr = obj_stack_.GetCurrent().Find(unit.id, false);
+      Object obj = ptr != nullptr ? *ptr : Object();
+
+      obj_stack_.Pop();
+      frame_stack_.pop();
+      code_stack_.pop_back();
+
+      if (error || ptr == nullptr || root == nullptr) {
+        trace::AddEvent("Cannot reload function " + unit.id + " - " + msg_string,
+          kStateWarning);
+        continue;
+      }
+
+      auto &impl = obj.Cast<FunctionImpl>();
+      ObjectPointer dest = root->Find(unit.id, false);
+
+      if (dest == nullptr) {
+        root->Add(unit.id, obj);
+      }
+      else if (dest->GetType() == kTypeFunction) {
+        auto &origin = dest->Cast<FunctionImpl>();
+#ifndef _DISABLE_SDL_
+        for (auto &handler : event_list_) {
+          if (handler.second == origin) handler.second = impl;
+        }
+#endif
+        origin = impl;
+      }
+      else {
+        trace::AddEvent("Cannot reload function " + unit.id + 
+          " - name is used by other object", kStateWarning);
+        continue;
+      }
+
+      trace::AddEvent("Function is reloaded - " + unit.id);
+    }
+
+    pending.clear();
+  }
+
   Message Machine::Invoke(Object obj, string id, const initializer_list<NamedObject> &&args) {
     FunctionImplPointer impl;
 
@@ -467,7 +581,7 @@ namespace kagami {
     obj_map.insert(NamedObject(kStrMe, obj));
 
     if (impl->GetType() == kFunctionVMCode) {
-      Run(true, id, &impl->GetCode(), &obj_map, &impl->GetClosureRecord());
+      Run(true, id, impl->GetCodeRecord(), &obj_map, &impl->GetClosureRecord());
       Object obj = frame_stack_.top().return_stack.top();
       frame_stack_.top().return_stack.pop();
       return Message().SetObject(obj);
@@ -476,18 +590,29 @@ namespace kagami {
     return impl->Start(obj_map);
   }
 
-  void Machine::CommandIfOrWhile(Keyword token, ArgumentList &args, size_t nest_end) {
+  void Machine::CommandIfOrWhile(Keyword token, OperandList &args, const Instruction &inst) {
     auto &frame = frame_stack_.top();
-    auto &code = code_stack_.front();
-    REQUIRED_ARG_COUNT(1);
+    auto &code = code_stack_.front().code;
+    size_t nest_end = inst.nest_end;
+    Object obj;
+
+    //Compare-and-branch superinstruction carries operands of comparison
+    if (inst.IsFused()) {
+      REQUIRED_ARG_COUNT(2);
+      obj = FusedOperation(args[0], args[1], inst);
+      if (frame.error) return;
+    }
+    else {
+      REQUIRED_ARG_COUNT(1);
+    }
 
     if (token == kKeywordIf || token == kKeywordWhile) {
       frame.AddJumpRecord(nest_end);
       code->FindJumpRecord(frame.idx + frame.jump_offset, frame.branch_jump_stack);
     }
     
-    Object obj = FetchObject(args[0]);
-    ERROR_CHECKING(obj.GetTypeId() != kTypeIdBool, "Invalid state value type.");
+    if (!inst.IsFused()) obj = FetchObject(args[0]);
+    ERROR_CHECKING(obj.GetType() != kTypeBool, "Invalid state value type.");
 
     bool state = obj.Cast<bool>();
 
@@ -541,7 +666,7 @@ namespace kagami {
     }
   }
 
-  void Machine::CommandForEach(ArgumentList &args, size_t nest_end) {
+  void Machine::CommandForEach(OperandList &args, size_t nest_end) {
     auto &frame = frame_stack_.top();
     ObjectMap obj_map;
 
@@ -574,7 +699,7 @@ namespace kagami {
     obj_stack_.CreateObject(unit_id, unit);
   }
 
-  void Machine::ForEachChecking(ArgumentList &args, size_t nest_end) {
+  void Machine::ForEachChecking(OperandList &args, size_t nest_end) {
     auto &frame = frame_stack_.top();
     auto unit_id = FetchObject(args[0]).Cast<string>();
     auto iterator = *obj_stack_.GetCurrent().Find(kStrIteratorObj);
@@ -589,7 +714,7 @@ namespace kagami {
 
     auto result = Invoke(iterator, kStrCompare,
       { NamedObject(kStrRightHandSide,tail) }).GetObj();
-    ERROR_CHECKING(result.GetTypeId() != kTypeIdBool,
+    ERROR_CHECKING(result.GetType() != kTypeBool,
       "Invalid iterator behavior");
 
     if (result.Cast<bool>()) {
@@ -602,9 +727,9 @@ namespace kagami {
     }
   }
 
-  void Machine::CommandCase(ArgumentList &args, size_t nest_end) {
+  void Machine::CommandCase(OperandList &args, size_t nest_end) {
     auto &frame = frame_stack_.top();
-    auto &code = code_stack_.front();
+    auto &code = code_stack_.front().code;
     ERROR_CHECKING(args.empty(), "Empty argument list");
     frame.AddJumpRecord(nest_end);
 
@@ -612,8 +737,7 @@ namespace kagami {
       code->FindJumpRecord(frame.idx + frame.jump_offset, frame.branch_jump_stack);
 
     Object obj = FetchObject(args[0]);
-    string type_id = obj.GetTypeId();
-    ERROR_CHECKING(!util::IsPlainType(type_id),
+    ERROR_CHECKING(!util::IsPlainType(obj.GetType()),
       "Non-plain object is not supported by case");
 
     Object sample_obj = type::CreateObjectCopy(obj);
@@ -645,7 +769,7 @@ namespace kagami {
     }
   }
 
-  void Machine::CommandWhen(ArgumentList &args) {
+  void Machine::CommandWhen(OperandList &args) {
     auto &frame = frame_stack_.top();
     bool result = false;
     ERROR_CHECKING(frame.condition_stack.empty(), 
@@ -658,12 +782,14 @@ namespace kagami {
 
     if (!args.empty()) {
       ObjectPointer ptr = obj_stack_.Find(kStrCaseObj);
-      string type_id = ptr->GetTypeId();
       bool found = false;
 
       ERROR_CHECKING(ptr == nullptr, 
         "Unexpected 'when'");
-      ERROR_CHECKING(!util::IsPlainType(type_id), 
+
+      TypeId type = ptr->GetType();
+
+      ERROR_CHECKING(!util::IsPlainType(type), 
         "Non-plain object is not supported by when");
 
 #define COMPARE_RESULT(_Type) (ptr->Cast<_Type>() == obj.Cast<_Type>())
@@ -671,18 +797,18 @@ namespace kagami {
       for (auto it = args.rbegin(); it != args.rend(); ++it) {
         Object obj = FetchObject(*it);
 
-        if (obj.GetTypeId() != type_id) continue;
+        if (obj.GetType() != type) continue;
 
-        if (type_id == kTypeIdInt) {
+        if (type == kTypeInt) {
           found = COMPARE_RESULT(int64_t);
         }
-        else if (type_id == kTypeIdFloat) {
+        else if (type == kTypeFloat) {
           found = COMPARE_RESULT(double);
         }
-        else if (type_id == kTypeIdString) {
+        else if (type == kTypeString) {
           found = COMPARE_RESULT(string);
         }
-        else if (type_id == kTypeIdBool) {
+        else if (type == kTypeBool) {
           found = COMPARE_RESULT(bool);
         }
 
@@ -793,20 +919,20 @@ namespace kagami {
     }
   }
 
-  void Machine::CommandHash(ArgumentList &args) {
+  void Machine::CommandHash(OperandList &args) {
     auto &frame = frame_stack_.top();
     auto &obj = FetchObject(args[0]).Unpack();
 
     if (type::IsHashable(obj)) {
       int64_t hash = type::GetHash(obj);
-      frame.RefreshReturnStack(Object(make_shared<int64_t>(hash), kTypeIdInt));
+      frame.RefreshReturnStack(Object(hash, kTypeIdInt));
     }
     else {
       frame.RefreshReturnStack(Object());
     }
   }
 
-  void Machine::CommandSwap(ArgumentList &args) {
+  void Machine::CommandSwap(OperandList &args) {
     auto &frame = frame_stack_.top();
     auto &right = FetchObject(args[1]).Unpack();
     auto &left = FetchObject(args[0]).Unpack();
@@ -814,12 +940,29 @@ namespace kagami {
     left.swap(right);
   }
 
-  void Machine::CommandBind(ArgumentList &args, bool local_value) {
-    using namespace type;
-    auto &frame = frame_stack_.top();
+  void Machine::CommandBind(OperandList &args, bool local_value) {
     //Do not change the order!
     auto rhs = FetchObject(args[1]);
-    auto lhs = FetchObject(args[0]);
+    BindObject(args[0], rhs, local_value);
+  }
+
+  //Operate-and-bind superinstruction: Bind(dest, lhs, rhs)
+  void Machine::CommandOperateAndBind(OperandList &args, const Instruction &inst) {
+    auto &frame = frame_stack_.top();
+    REQUIRED_ARG_COUNT(3);
+
+    auto rhs = FusedOperation(args[1], args[2], inst);
+
+    if (frame.error) return;
+
+    rhs.SetDeliverFlag();
+    BindObject(args[0], rhs, inst.IsLocalObject());
+  }
+
+  void Machine::BindObject(const Operand &dest, Object &rhs, bool local_value) {
+    using namespace type;
+    auto &frame = frame_stack_.top();
+    auto lhs = FetchObject(dest);
 
     if (lhs.IsRef()) {
       auto &real_lhs = lhs.Unpack();
@@ -833,7 +976,10 @@ namespace kagami {
         "Invalid object id.");
 
       if (!local_value) {
-        ObjectPointer ptr = obj_stack_.Find(id);
+        ObjectPointer ptr = dest.HasSlot() ? 
+          frame.slots[dest.slot] : nullptr;
+
+        if (ptr == nullptr) ptr = obj_stack_.Find(id);
 
         if (ptr != nullptr) {
           ptr->Unpack() = CreateObjectCopy(rhs);
@@ -845,10 +991,11 @@ namespace kagami {
 
       ERROR_CHECKING(!obj_stack_.CreateObject(id, obj),
         "Object binding failed.");
+      BindSlot(dest, id);
     }
   }
 
-  void Machine::CommandDeliver(ArgumentList &args, bool local_value) {
+  void Machine::CommandDeliver(OperandList &args, bool local_value) {
     auto &frame = frame_stack_.top();
     //Do not change the order!
     auto rhs = FetchObject(args[1]);
@@ -866,7 +1013,10 @@ namespace kagami {
         "Invalid object id.");
 
       if (!local_value) {
-        ObjectPointer ptr = obj_stack_.Find(id);
+        ObjectPointer ptr = args[0].HasSlot() ?
+          frame.slots[args[0].slot] : nullptr;
+
+        if (ptr == nullptr) ptr = obj_stack_.Find(id);
 
         if (ptr != nullptr) {
           ptr->Unpack() = rhs.Unpack();
@@ -879,17 +1029,18 @@ namespace kagami {
       rhs.Unpack() = Object();
       ERROR_CHECKING(!obj_stack_.CreateObject(id, obj),
         "Object binding failed.");
+      BindSlot(args[0], id);
     }
   }
 
-  void Machine::CommandTypeId(ArgumentList &args) {
+  void Machine::CommandTypeId(OperandList &args) {
     auto &frame = frame_stack_.top();
 
     if (args.size() > 1) {
-      ManagedArray base = make_shared<ObjectArray>();
+      ManagedArray base = MakePooled<ObjectArray>();
 
       for (auto &unit : args) {
-        base->emplace_back(Object(FetchObject(unit).GetTypeId()));
+        base->Write().emplace_back(Object(FetchObject(unit).GetTypeId()));
       }
 
       Object obj(base, kTypeIdArray);
@@ -903,46 +1054,46 @@ namespace kagami {
     }
   }
 
-  void Machine::CommandMethods(ArgumentList &args) {
+  void Machine::CommandMethods(OperandList &args) {
     auto &frame = frame_stack_.top();
     REQUIRED_ARG_COUNT(1);
 
     Object obj = FetchObject(args[0]);
-    auto methods = type::GetMethods(obj.GetTypeId());
-    ManagedArray base = make_shared<ObjectArray>();
+    auto methods = type::GetMethods(obj.GetType());
+    ManagedArray base = MakePooled<ObjectArray>();
 
     for (auto &unit : methods) {
-      base->emplace_back(Object(unit, kTypeIdString));
+      base->Write().emplace_back(Object(unit, kTypeIdString));
     }
 
     Object ret_obj(base, kTypeIdArray);
     frame.RefreshReturnStack(ret_obj);
   }
 
-  void Machine::CommandExist(ArgumentList &args) {
+  void Machine::CommandExist(OperandList &args) {
     auto &frame = frame_stack_.top();
     REQUIRED_ARG_COUNT(2);
 
     //Do not change the order
     auto str_obj = FetchObject(args[1]);
     auto obj = FetchObject(args[0]);
-    ERROR_CHECKING(str_obj.GetTypeId() != kTypeIdString, "Invalid method id");
+    ERROR_CHECKING(str_obj.GetType() != kTypeString, "Invalid method id");
 
     string str = str_obj.Cast<string>();
-    Object ret_obj(type::CheckMethod(str, obj.GetTypeId()), kTypeIdBool);
+    Object ret_obj(type::CheckMethod(str, obj.GetType()), kTypeBool);
 
     frame.RefreshReturnStack(ret_obj);
   }
 
-  void Machine::CommandNullObj(ArgumentList &args) {
+  void Machine::CommandNullObj(OperandList &args) {
     auto &frame = frame_stack_.top();
     REQUIRED_ARG_COUNT(1);
 
     Object obj = FetchObject(args[0]);
-    frame.RefreshReturnStack(Object(obj.GetTypeId() == kTypeIdNull, kTypeIdBool));
+    frame.RefreshReturnStack(Object(obj.GetType() == kTypeNull, kTypeIdBool));
   }
 
-  void Machine::CommandDestroy(ArgumentList &args) {
+  void Machine::CommandDestroy(OperandList &args) {
     auto &frame = frame_stack_.top();
     REQUIRED_ARG_COUNT(1);
 
@@ -950,7 +1101,7 @@ namespace kagami {
     obj.swap(Object());
   }
 
-  void Machine::CommandConvert(ArgumentList &args) {
+  void Machine::CommandConvert(OperandList &args) {
     auto &frame = frame_stack_.top();
     REQUIRED_ARG_COUNT(1);
 
@@ -960,22 +1111,22 @@ namespace kagami {
     }
     else {
       Object obj = FetchObject(args[0]);
-      string type_id = obj.GetTypeId();
+      TypeId obj_type = obj.GetType();
       Object ret_obj;
 
-      if (type_id == kTypeIdString) {
+      if (obj_type == kTypeString) {
         auto str = obj.Cast<string>();
         auto type = util::GetStringType(str, true);
 
         switch (type) {
         case kStringTypeInt:
-          ret_obj.PackContent(make_shared<int64_t>(stol(str)), kTypeIdInt);
+          ret_obj = Object(int64_t(stol(str)), kTypeIdInt);
           break;
         case kStringTypeFloat:
-          ret_obj.PackContent(make_shared<double>(stod(str)), kTypeIdFloat);
+          ret_obj = Object(stod(str), kTypeIdFloat);
           break;
         case kStringTypeBool:
-          ret_obj.PackContent(make_shared<bool>(str == kStrTrue), kTypeIdBool);
+          ret_obj = Object(str == kStrTrue, kTypeIdBool);
           break;
         default:
           ret_obj = obj;
@@ -983,7 +1134,7 @@ namespace kagami {
         }
       }
       else {
-        ERROR_CHECKING(!type::CheckMethod(kStrGetStr, type_id),
+        ERROR_CHECKING(!type::CheckMethod(kStrGetStr, obj_type),
           "Invalid argument of convert()");
 
         auto ret_obj = Invoke(obj, kStrGetStr).GetObj();
@@ -993,12 +1144,12 @@ namespace kagami {
     }
   }
 
-  void Machine::CommandRefCount(ArgumentList &args) {
+  void Machine::CommandRefCount(OperandList &args) {
     auto &frame = frame_stack_.top();
     REQUIRED_ARG_COUNT(1);
 
     auto &obj = FetchObject(args[0]).Unpack();
-    Object ret_obj(make_shared<int64_t>(obj.ObjRefCount()), kTypeIdInt);
+    Object ret_obj(obj.ObjRefCount(), kTypeIdInt);
 
     frame.RefreshReturnStack(ret_obj);
   }
@@ -1021,122 +1172,203 @@ namespace kagami {
     frame.RefreshReturnStack(Object(kCodeName));
   }
 
-  template <Keyword op_code>
-  void Machine::BinaryMathOperatorImpl(ArgumentList &args) {
-    auto &frame = frame_stack_.top();
-    REQUIRED_ARG_COUNT(2);
-    auto rhs = FetchObject(args[1]);
-    auto lhs = FetchObject(args[0]);
-    auto type_rhs = FindTypeCode(rhs.GetTypeId());
-    auto type_lhs = FindTypeCode(lhs.GetTypeId());
+  /*
+    Kernel selection for operator instruction.
+    After the first execution, instruction is quickened with plain types of
+    its operands. Later executions only compare type ids with the recorded
+    ones, and instruction falls back to generic lookup forever if another
+    pair shows up. Record is kept in BytecodeState of the running code.
+  */
+  BinaryKernelPointer FetchBinaryKernel(const BinaryKernelTable &table,
+    Object &lhs, Object &rhs, uint8_t &quick) {
+    if (quick != kQuickNone && quick != kQuickGeneric) {
+      auto quick_lhs = quick >> 4, quick_rhs = quick & 0x0F;
 
-    if (type_rhs == kNotPlainType || type_rhs == kNotPlainType) {
-      frame.MakeError("Try to operate with non-plain type.");
-      return;
-    }
+      if (lhs.GetType() == kPlainTypeIds[quick_lhs] &&
+        rhs.GetType() == kPlainTypeIds[quick_rhs]) {
+        return table[quick_lhs][quick_rhs];
+      }
 
-    auto result_type = kResultDynamicTraits.at(ResultTraitKey(type_lhs, type_rhs));
+      quick = kQuickGeneric;
+    }
 
-#define RESULT_PROCESSING(_Type, _Func, _TypeId)                       \
-  _Type result = MathBox<_Type, op_code>().Do(_Func(lhs), _Func(rhs)); \
-  frame.RefreshReturnStack(Object(result, _TypeId));
+    auto type_lhs = FindTypeCode(lhs.GetType());
+    auto type_rhs = FindTypeCode(rhs.GetType());
 
-    if (result_type == kPlainString) {
-      if (IsIllegalStringOperator(op_code)) {
-        frame.RefreshReturnStack();
-        return;
-      }
+    if (type_lhs == kNotPlainType || type_rhs == kNotPlainType) return nullptr;
 
-      RESULT_PROCESSING(string, StringProducer, kTypeIdString);
-    }
-    else if (result_type == kPlainInt) {
-      RESULT_PROCESSING(int64_t, IntProducer, kTypeIdInt);
-    }
-    else if (result_type == kPlainFloat) {
-      RESULT_PROCESSING(double, FloatProducer, kTypeIdFloat);
+    if (quick == kQuickNone) {
+      quick = static_cast<uint8_t>((type_lhs << 4) | type_rhs);
     }
-    else if (result_type == kPlainBool) {
-      RESULT_PROCESSING(bool, BoolProducer, kTypeIdBool);
+
+    return table[type_lhs][type_rhs];
+  }
+
+  //Compile-time evaluation for constant folding.
+  //Only plain operands are accepted, and zero divisor is left to runtime.
+  bool EvaluateConstant(Keyword op, Object &lhs, Object &rhs, Object &result) {
+    auto type_lhs = FindTypeCode(lhs.GetType());
+    auto type_rhs = FindTypeCode(rhs.GetType());
+    BinaryKernelPointer kernel = nullptr;
+
+    if (type_lhs == kNotPlainType || type_rhs == kNotPlainType) return false;
+    if (op == kKeywordDivide && IntProducer(rhs) == 0) return false;
+
+#define KERNEL_CASE(_OP)     case _OP: kernel = kBinaryKernels<_OP>[type_lhs][type_rhs]; break;
+
+    switch (op) {
+    KERNEL_CASE(kKeywordPlus)
+    KERNEL_CASE(kKeywordMinus)
+    KERNEL_CASE(kKeywordTimes)
+    KERNEL_CASE(kKeywordDivide)
+    KERNEL_CASE(kKeywordEquals)
+    KERNEL_CASE(kKeywordLessOrEqual)
+    KERNEL_CASE(kKeywordGreaterOrEqual)
+    KERNEL_CASE(kKeywordNotEqual)
+    KERNEL_CASE(kKeywordGreater)
+    KERNEL_CASE(kKeywordLess)
+    KERNEL_CASE(kKeywordAnd)
+    KERNEL_CASE(kKeywordOr)
+    default:break;
     }
-#undef RESULT_PROCESSING
+#undef KERNEL_CASE
+
+    if (kernel == nullptr) return false;
+
+    result = kernel(lhs, rhs);
+    return !result.Null();
   }
 
   template <Keyword op_code>
-  void Machine::BinaryLogicOperatorImpl(ArgumentList &args) {
-    using namespace type;
+  Object Machine::BinaryMathOperation(Object &lhs, Object &rhs, uint8_t &quick) {
     auto &frame = frame_stack_.top();
+    auto kernel = FetchBinaryKernel(kBinaryKernels<op_code>, lhs, rhs, quick);
 
-    REQUIRED_ARG_COUNT(2);
+    if (kernel == nullptr) {
+      frame.MakeError("Try to operate with non-plain type.");
+      return Object();
+    }
 
-    auto rhs = FetchObject(args[1]);
-    auto lhs = FetchObject(args[0]);
-    auto type_rhs = FindTypeCode(rhs.GetTypeId());
-    auto type_lhs = FindTypeCode(lhs.GetTypeId());
-    bool result = false;
+    return kernel(lhs, rhs);
+  }
 
-    if (!util::IsPlainType(lhs.GetTypeId())) {
+  template <Keyword op_code>
+  Object Machine::BinaryLogicOperation(Object &lhs, Object &rhs, uint8_t &quick) {
+    using namespace type;
+    auto &frame = frame_stack_.top();
+
+    if (!util::IsPlainType(lhs.GetType())) {
       if (op_code != kKeywordEquals && op_code != kKeywordNotEqual) {
-        frame.RefreshReturnStack();
-        return;
+        return Object();
       }
 
-      if (!CheckMethod(kStrCompare, lhs.GetTypeId())) {
+      if (!CheckMethod(kStrCompare, lhs.GetType())) {
         frame.MakeError("Can't operate with this operator.");
-        return;
+        return Object();
       }
 
       Object obj = Invoke(lhs, kStrCompare,
         { NamedObject(kStrRightHandSide, rhs) }).GetObj();
 
-      if (obj.GetTypeId() != kTypeIdBool) {
+      if (obj.GetType() != kTypeBool) {
         frame.MakeError("Invalid behavior of compare().");
-        return;
+        return Object();
       }
 
       if (op_code == kKeywordNotEqual) {
         bool value = !obj.Cast<bool>();
-        frame.RefreshReturnStack(Object(value, kTypeIdBool));
-      }
-      else {
-        frame.RefreshReturnStack(obj);
+        return Object(value, kTypeBool);
       }
-      return;
-    }
 
-    auto result_type = kResultDynamicTraits.at(ResultTraitKey(type_lhs, type_rhs));
-#define RESULT_PROCESSING(_Type, _Func)\
-  result = LogicBox<_Type, op_code>().Do(_Func(lhs), _Func(rhs));
+      return obj;
+    }
 
-    if (result_type == kPlainString) {
-      if (IsIllegalStringOperator(op_code)) {
-        frame.RefreshReturnStack();
-        return;
-      }
+    auto kernel = FetchBinaryKernel(kBinaryKernels<op_code>, lhs, rhs, quick);
 
-      RESULT_PROCESSING(string, StringProducer);
-    }
-    else if (result_type == kPlainInt) {
-      RESULT_PROCESSING(int64_t, IntProducer);
-    }
-    else if (result_type == kPlainFloat) {
-      RESULT_PROCESSING(double, FloatProducer);
+    if (kernel == nullptr) {
+      frame.MakeError("Try to operate with non-plain type.");
+      return Object();
     }
-    else if (result_type == kPlainBool) {
-      RESULT_PROCESSING(bool, BoolProducer);
+
+    return kernel(lhs, rhs);
+  }
+
+  template <Keyword op_code>
+  void Machine::BinaryMathOperatorImpl(OperandList &args) {
+    auto &frame = frame_stack_.top();
+    REQUIRED_ARG_COUNT(2);
+    auto rhs = FetchObject(args[1]);
+    auto lhs = FetchObject(args[0]);
+    auto &quick = GetCurrentState().GetQuick(frame.idx);
+    auto result = BinaryMathOperation<op_code>(lhs, rhs, quick);
+
+    if (frame.error) return;
+
+    frame.RefreshReturnStack(result);
+  }
+
+  template <Keyword op_code>
+  void Machine::BinaryLogicOperatorImpl(OperandList &args) {
+    auto &frame = frame_stack_.top();
+    REQUIRED_ARG_COUNT(2);
+    auto rhs = FetchObject(args[1]);
+    auto lhs = FetchObject(args[0]);
+    auto &quick = GetCurrentState().GetQuick(frame.idx);
+    auto result = BinaryLogicOperation<op_code>(lhs, rhs, quick);
+
+    if (frame.error) return;
+
+    frame.RefreshReturnStack(result);
+  }
+
+  //Operator part of superinstruction
+  Object Machine::FusedOperation(const Operand &lhs_arg, const Operand &rhs_arg, const Instruction &inst) {
+    auto &frame = frame_stack_.top();
+    //Do not change the order!
+    auto rhs = FetchObject(rhs_arg);
+    auto lhs = FetchObject(lhs_arg);
+    auto &quick = GetCurrentState().GetQuick(frame.idx);
+
+    switch (inst.GetFusedOp()) {
+    case kKeywordPlus:
+      return BinaryMathOperation<kKeywordPlus>(lhs, rhs, quick);
+    case kKeywordMinus:
+      return BinaryMathOperation<kKeywordMinus>(lhs, rhs, quick);
+    case kKeywordTimes:
+      return BinaryMathOperation<kKeywordTimes>(lhs, rhs, quick);
+    case kKeywordDivide:
+      return BinaryMathOperation<kKeywordDivide>(lhs, rhs, quick);
+    case kKeywordEquals:
+      return BinaryLogicOperation<kKeywordEquals>(lhs, rhs, quick);
+    case kKeywordLessOrEqual:
+      return BinaryLogicOperation<kKeywordLessOrEqual>(lhs, rhs, quick);
+    case kKeywordGreaterOrEqual:
+      return BinaryLogicOperation<kKeywordGreaterOrEqual>(lhs, rhs, quick);
+    case kKeywordNotEqual:
+      return BinaryLogicOperation<kKeywordNotEqual>(lhs, rhs, quick);
+    case kKeywordGreater:
+      return BinaryLogicOperation<kKeywordGreater>(lhs, rhs, quick);
+    case kKeywordLess:
+      return BinaryLogicOperation<kKeywordLess>(lhs, rhs, quick);
+    case kKeywordAnd:
+      return BinaryLogicOperation<kKeywordAnd>(lhs, rhs, quick);
+    case kKeywordOr:
+      return BinaryLogicOperation<kKeywordOr>(lhs, rhs, quick);
+    default:break;
     }
 
-    frame.RefreshReturnStack(Object(result, kTypeIdBool));
-#undef RESULT_PROCESSING
+    frame.MakeError("Invalid superinstruction.");
+    return Object();
   }
 
-  void Machine::OperatorLogicNot(ArgumentList &args) {
+  void Machine::OperatorLogicNot(OperandList &args) {
     auto &frame = frame_stack_.top();
 
     REQUIRED_ARG_COUNT(1);
 
     auto rhs = FetchObject(args[0]);
 
-    if (rhs.GetTypeId() != kTypeIdBool) {
+    if (rhs.GetType() != kTypeBool) {
       frame.MakeError("Can't operate with this operator");
       return;
     }
@@ -1147,20 +1379,20 @@ namespace kagami {
   }
 
 
-  void Machine::ExpList(ArgumentList &args) {
+  void Machine::ExpList(OperandList &args) {
     auto &frame = frame_stack_.top();
     if (!args.empty()) {
       frame.RefreshReturnStack(FetchObject(args.back()));
     }
   }
 
-  void Machine::InitArray(ArgumentList &args) {
+  void Machine::InitArray(OperandList &args) {
     auto &frame = frame_stack_.top();
-    ManagedArray base = make_shared<ObjectArray>();
+    ManagedArray base = MakePooled<ObjectArray>();
 
     if (!args.empty()) {
       for (auto &unit : args) {
-        base->emplace_back(FetchObject(unit));
+        base->Write().emplace_back(FetchObject(unit));
       }
     }
 
@@ -1168,7 +1400,7 @@ namespace kagami {
     frame.RefreshReturnStack(obj);
   }
 
-  void Machine::CommandReturn(ArgumentList &args) {
+  void Machine::CommandReturn(OperandList &args) {
     if (frame_stack_.size() <= 1) {
       trace::AddEvent("Unexpected return.", kStateError);
       return;
@@ -1197,9 +1429,9 @@ namespace kagami {
       frame_stack_.top().RefreshReturnStack(Object());
     }
     else {
-      ManagedArray obj_array = make_shared<ObjectArray>();
+      ManagedArray obj_array = MakePooled<ObjectArray>();
       for (auto it = args.begin(); it != args.end(); ++it) {
-        obj_array->emplace_back(FetchObject(*it).Unpack());
+        obj_array->Write().emplace_back(FetchObject(*it).Unpack());
       }
       Object ret_obj(obj_array, kTypeIdArray);
 
@@ -1214,7 +1446,7 @@ namespace kagami {
     }
   }
 #ifndef _DISABLE_SDL_
-  void Machine::CommandHandle(ArgumentList &args) {
+  void Machine::CommandHandle(OperandList &args) {
     auto &frame = frame_stack_.top();
 
     REQUIRED_ARG_COUNT(3);
@@ -1234,127 +1466,66 @@ namespace kagami {
     event_list_.insert(dest);
   }
 
-  void Machine::CommandWait(ArgumentList &args) {
+  void Machine::CommandWait(OperandList &args) {
     hanging = true;
   }
 
-  void Machine::CommandLeave(ArgumentList &args) {
+  void Machine::CommandLeave(OperandList &args) {
     hanging = false;
   }
 #endif
-  void Machine::MachineCommands(Keyword token, ArgumentList &args, Request &request) {
-    auto &frame = frame_stack_.top();
-
-    switch (token) {
-    case kKeywordPlus:
-      BinaryMathOperatorImpl<kKeywordPlus>(args);
-      break;
-    case kKeywordMinus:
-      BinaryMathOperatorImpl<kKeywordMinus>(args);
-      break;
-    case kKeywordTimes:
-      BinaryMathOperatorImpl<kKeywordTimes>(args);
-      break;
-    case kKeywordDivide:
-      BinaryMathOperatorImpl<kKeywordDivide>(args);
-      break;
-    case kKeywordEquals:
-      BinaryLogicOperatorImpl<kKeywordEquals>(args);
-      break;
-    case kKeywordLessOrEqual:
-      BinaryLogicOperatorImpl<kKeywordLessOrEqual>(args);
-      break;
-    case kKeywordGreaterOrEqual:
-      BinaryLogicOperatorImpl<kKeywordGreaterOrEqual>(args);
-      break;
-    case kKeywordNotEqual:
-      BinaryLogicOperatorImpl<kKeywordNotEqual>(args);
-      break;
-    case kKeywordGreater:
-      BinaryLogicOperatorImpl<kKeywordGreater>(args);
-      break;
-    case kKeywordLess:
-      BinaryLogicOperatorImpl<kKeywordLess>(args);
-      break;
-    case kKeywordAnd:
-      BinaryLogicOperatorImpl<kKeywordAnd>(args);
-      break;
-    case kKeywordOr:
-      BinaryLogicOperatorImpl<kKeywordOr>(args);
-      break;
-    case kKeywordNot:
-      OperatorLogicNot(args);
-      break;
-    case kKeywordHash:
-      CommandHash(args);
-      break;
-    case kKeywordFor:
-      CommandForEach(args, request.option.nest_end);
-      break;
-    case kKeywordNullObj:
-      CommandNullObj(args);
-      break;
-    case kKeywordDestroy:
-      CommandDestroy(args);
-      break;
-    case kKeywordConvert:
-      CommandConvert(args);
-      break;
-    case kKeywordRefCount:
-      CommandRefCount(args);
-      break;
-    case kKeywordTime:
-      CommandTime();
-      break;
-    case kKeywordVersion:
-      CommandVersion();
-      break;
-    case kKeywordCodeName:
-      CommandMachineCodeName();
-      break;
-    case kKeywordSwap:
-      CommandSwap(args);
-      break;
-    case kKeywordBind:
-      CommandBind(args, request.option.local_object);
-      break;
-    case kKeywordDeliver:
-      CommandDeliver(args, request.option.local_object);
-      break;
-    case kKeywordExpList:
-      ExpList(args);
-      break;
-    case kKeywordInitialArray:
-      InitArray(args);
-      break;
-    case kKeywordReturn:
-      CommandReturn(args);
-      break;
-    case kKeywordTypeId:
-      CommandTypeId(args);
-      break;
-    case kKeywordDir:
-      CommandMethods(args);
-      break;
-    case kKeywordExist:
-      CommandExist(args);
-      break;
-    case kKeywordFn:
-      ClosureCatching(args, request.option.nest_end, frame_stack_.size() > 1);
-      break;
-    case kKeywordCase:
-      CommandCase(args, request.option.nest_end);
-      break;
-    case kKeywordWhen:
-      CommandWhen(args);
-      break;
-    case kKeywordEnd:
-      switch (request.option.nest_root) {
+  /*
+    Implementation of every built-in command. Both dispatch engines reach
+    the command through this template, so they only differ in the way of
+    selecting the entry.
+  */
+  template <Keyword token>
+  void Machine::CommandEntry(OperandList &args, const Instruction &inst) {
+    if constexpr (token == kKeywordPlus || token == kKeywordMinus ||
+      token == kKeywordTimes || token == kKeywordDivide) {
+      BinaryMathOperatorImpl<token>(args);
+    }
+    else if constexpr (token == kKeywordEquals || token == kKeywordLessOrEqual ||
+      token == kKeywordGreaterOrEqual || token == kKeywordNotEqual ||
+      token == kKeywordGreater || token == kKeywordLess ||
+      token == kKeywordAnd || token == kKeywordOr) {
+      BinaryLogicOperatorImpl<token>(args);
+    }
+    else if constexpr (token == kKeywordNot) OperatorLogicNot(args);
+    else if constexpr (token == kKeywordHash) CommandHash(args);
+    else if constexpr (token == kKeywordFor) CommandForEach(args, inst.nest_end);
+    else if constexpr (token == kKeywordNullObj) CommandNullObj(args);
+    else if constexpr (token == kKeywordDestroy) CommandDestroy(args);
+    else if constexpr (token == kKeywordConvert) CommandConvert(args);
+    else if constexpr (token == kKeywordRefCount) CommandRefCount(args);
+    else if constexpr (token == kKeywordTime) CommandTime();
+    else if constexpr (token == kKeywordVersion) CommandVersion();
+    else if constexpr (token == kKeywordCodeName) CommandMachineCodeName();
+    else if constexpr (token == kKeywordSwap) CommandSwap(args);
+    else if constexpr (token == kKeywordBind) {
+      inst.IsFused() ?
+        CommandOperateAndBind(args, inst) :
+        CommandBind(args, inst.IsLocalObject());
+    }
+    else if constexpr (token == kKeywordDeliver) CommandDeliver(args, inst.IsLocalObject());
+    else if constexpr (token == kKeywordExpList) ExpList(args);
+    else if constexpr (token == kKeywordInitialArray) InitArray(args);
+    else if constexpr (token == kKeywordReturn) CommandReturn(args);
+    else if constexpr (token == kKeywordTypeId) CommandTypeId(args);
+    else if constexpr (token == kKeywordDir) CommandMethods(args);
+    else if constexpr (token == kKeywordExist) CommandExist(args);
+    else if constexpr (token == kKeywordFn) {
+      ClosureCatching(args, inst.nest_end, frame_stack_.size() > 1);
+    }
+    else if constexpr (token == kKeywordCase) CommandCase(args, inst.nest_end);
+    else if constexpr (token == kKeywordWhen) CommandWhen(args);
+    else if constexpr (token == kKeywordEnd) {
+      switch (inst.GetNestRoot()) {
       case kKeywordWhile:
-        CommandLoopEnd(request.option.nest);
+        CommandLoopEnd(inst.nest);
         break;
       case kKeywordFor:
-        CommandForEachEnd(request.option.nest);
+        CommandForEachEnd(inst.nest);
         break;
       case kKeywordIf:
       case kKeywordCase:
@@ -1362,37 +1533,80 @@ namespace kagami {
         break;
       default:break;
       }
+    }
+    else if constexpr (token == kKeywordContinue || token == kKeywordBreak) {
+      CommandContinueOrBreak(token, inst.escape_depth);
+    }
+    else if constexpr (token == kKeywordElse) CommandElse();
+    else if constexpr (token == kKeywordIf || token == kKeywordElif ||
+      token == kKeywordWhile) {
+      CommandIfOrWhile(token, args, inst);
+    }
+#ifndef _DISABLE_SDL_
+    else if constexpr (token == kKeywordHandle) CommandHandle(args);
+    else if constexpr (token == kKeywordWait) CommandWait(args);
+    else if constexpr (token == kKeywordLeave) CommandLeave(args);
+#endif
+  }
 
-      break;
-    case kKeywordContinue:
-    case kKeywordBreak:
-      CommandContinueOrBreak(token, request.option.escape_depth);
-      break;
-    case kKeywordElse:
-      CommandElse();
-      break;
-    case kKeywordIf:
-    case kKeywordElif:
-    case kKeywordWhile:
-      CommandIfOrWhile(token, args, request.option.nest_end);
-      break;
+#define COMMAND_CASE(_Token) \
+  case _Token: CommandEntry<_Token>(args, inst); break;
+
+#define COMMAND_TABLE_ENTRY(_Token) \
+  table[_Token] = &Machine::CommandEntry<_Token>;
+
+#define MACHINE_COMMANDS(_Func)                                    \
+  _Func(kKeywordPlus) _Func(kKeywordMinus) _Func(kKeywordTimes)    \
+  _Func(kKeywordDivide) _Func(kKeywordEquals)                      \
+  _Func(kKeywordLessOrEqual) _Func(kKeywordGreaterOrEqual)         \
+  _Func(kKeywordNotEqual) _Func(kKeywordGreater) _Func(kKeywordLess) \
+  _Func(kKeywordAnd) _Func(kKeywordOr) _Func(kKeywordNot)          \
+  _Func(kKeywordHash) _Func(kKeywordFor) _Func(kKeywordNullObj)    \
+  _Func(kKeywordDestroy) _Func(kKeywordConvert)                    \
+  _Func(kKeywordRefCount) _Func(kKeywordTime) _Func(kKeywordVersion) \
+  _Func(kKeywordCodeName) _Func(kKeywordSwap) _Func(kKeywordBind)  \
+  _Func(kKeywordDeliver) _Func(kKeywordExpList)                    \
+  _Func(kKeywordInitialArray) _Func(kKeywordReturn)                \
+  _Func(kKeywordTypeId) _Func(kKeywordDir) _Func(kKeywordExist)    \
+  _Func(kKeywordFn) _Func(kKeywordCase) _Func(kKeywordWhen)        \
+  _Func(kKeywordEnd) _Func(kKeywordContinue) _Func(kKeywordBreak)  \
+  _Func(kKeywordElse) _Func(kKeywordIf) _Func(kKeywordElif)        \
+  _Func(kKeywordWhile)
+
+#define MACHINE_COMMANDS_SDL(_Func) \
+  _Func(kKeywordHandle) _Func(kKeywordWait) _Func(kKeywordLeave)
+
+  void Machine::MachineCommands(Keyword token, OperandList &args, const Instruction &inst) {
+    switch (token) {
+    MACHINE_COMMANDS(COMMAND_CASE)
 #ifndef _DISABLE_SDL_
-    case kKeywordHandle:
-      CommandHandle(args);
-      break;
-    case kKeywordWait:
-      CommandWait(args);
-      break;
-    case kKeywordLeave:
-      CommandLeave(args);
-      break;
+    MACHINE_COMMANDS_SDL(COMMAND_CASE)
 #endif
     default:
       break;
     }
   }
 
-  void Machine::GenerateArgs(FunctionImpl &impl, ArgumentList &args, ObjectMap &obj_map) {
+  const Machine::CommandTable &Machine::GetCommandTable() {
+    static CommandTable table = []() -> CommandTable {
+      CommandTable table;
+      table.fill(&Machine::CommandEntry<kKeywordNull>);
+      MACHINE_COMMANDS(COMMAND_TABLE_ENTRY)
+#ifndef _DISABLE_SDL_
+      MACHINE_COMMANDS_SDL(COMMAND_TABLE_ENTRY)
+#endif
+      return table;
+    }();
+
+    return table;
+  }
+
+#undef MACHINE_COMMANDS_SDL
+#undef MACHINE_COMMANDS
+#undef COMMAND_TABLE_ENTRY
+#undef COMMAND_CASE
+
+  void Machine::GenerateArgs(FunctionImpl &impl, OperandList &args, ObjectMap &obj_map) {
     switch (impl.GetPattern()) {
     case kParamNormal:
       Generate_Normal(impl, args, obj_map);
@@ -1408,7 +1622,7 @@ namespace kagami {
     }
   }
 
-  void Machine::Generate_Normal(FunctionImpl &impl, ArgumentList &args, ObjectMap &obj_map) {
+  void Machine::Generate_Normal(FunctionImpl &impl, OperandList &args, ObjectMap &obj_map) {
     auto &frame = frame_stack_.top();
     auto &params = impl.GetParameters();
     size_t pos = args.size() - 1;
@@ -1425,11 +1639,11 @@ namespace kagami {
     }
   }
 
-  void Machine::Generate_AutoSize(FunctionImpl &impl, ArgumentList &args, ObjectMap &obj_map) {
+  void Machine::Generate_AutoSize(FunctionImpl &impl, OperandList &args, ObjectMap &obj_map) {
     auto &frame = frame_stack_.top();
     vector<string> &params = impl.GetParameters();
     list<Object> temp_list;
-    ManagedArray va_base = make_shared<ObjectArray>();
+    ManagedArray va_base = MakePooled<ObjectArray>();
     size_t pos = args.size(), diff = args.size() - params.size() + 1;
 
     ERROR_CHECKING(args.size() < params.size(),
@@ -1443,7 +1657,7 @@ namespace kagami {
 
     if (!temp_list.empty()) {
       for (auto it = temp_list.begin(); it != temp_list.end(); ++it) {
-        va_base->emplace_back(*it);
+        va_base->Write().emplace_back(*it);
       }
 
       temp_list.clear();
@@ -1459,7 +1673,7 @@ namespace kagami {
     }
   }
 
-  void Machine::Generate_AutoFill(FunctionImpl &impl, ArgumentList &args, ObjectMap &obj_map) {
+  void Machine::Generate_AutoFill(FunctionImpl &impl, OperandList &args, ObjectMap &obj_map) {
     auto &frame = frame_stack_.top();
     auto &params = impl.GetParameters();
     size_t limit = impl.GetLimit();
@@ -1483,6 +1697,29 @@ namespace kagami {
   }
 
 #ifndef _DISABLE_SDL_
+  EventPumpOption &GetEventPumpOption() {
+    static EventPumpOption option{ kDefaultEventInterval, kDefaultEventBudget };
+    return option;
+  }
+
+  //Drain all pending events of SDL into machine queue in one pass
+  void Machine::PumpEvents(bool wait) {
+    SDL_Event event;
+
+    if (wait) {
+      //Wait for a limited time when script file is watched
+      int result = reloader_ != nullptr ?
+        SDL_WaitEventTimeout(&event, static_cast<int>(kReloadInterval)) :
+        SDL_WaitEvent(&event);
+
+      if (result != 0) event_queue_.push_back(event);
+    }
+
+    while (SDL_PollEvent(&event) != 0) {
+      event_queue_.push_back(event);
+    }
+  }
+
   void Machine::LoadEventInfo(SDL_Event &event, ObjectMap &obj_map, FunctionImpl &impl) {
     auto &frame = frame_stack_.top();
 
@@ -1507,27 +1744,34 @@ namespace kagami {
     This function contains main logic implementation.
     VM runs single command in every single tick of machine loop.
   */
-  void Machine::Run(bool invoking, string id, VMCodePointer ptr, ObjectMap *p,
+  void Machine::Run(bool invoking, string id, CodeRecord record, ObjectMap *p,
     ObjectMap *closure_record) {
     if (code_stack_.empty()) return;
 
     if (invoking) {
-      code_stack_.push_back(ptr);
+      code_stack_.push_back(record);
     }
 
     bool interface_error = false;
     bool invoking_error = false;
     size_t stop_point = invoking ? frame_stack_.size() : 0;
     size_t script_idx = 0;
+    size_t reload_ticks = 0;
     Message msg;
-    VMCode *code = code_stack_.back();
-    Command *command = nullptr;
+    const Bytecode *code = &code_stack_.back().code->GetBytecode();
+    const Instruction *inst = nullptr;
+    OperandList args;
     FunctionImplPointer impl;
     ObjectMap obj_map;
 #ifndef _DISABLE_SDL_
     SDL_Event event;
+    auto &pump_option = GetEventPumpOption();
+    size_t pump_ticks = 0;
+    Uint32 last_pump = SDL_GetTicks();
 #endif
-    frame_stack_.push(RuntimeFrame());
+    auto &stats = stats_;
+    if (collect_stats_ && !invoking) AttachRuntimeStats(&stats_);
+    frame_stack_.emplace();
     obj_stack_.Push();
 
     if (invoking) {
@@ -1536,26 +1780,47 @@ namespace kagami {
       obj_stack_.MergeMap(*closure_record);
       frame_stack_.top().function_scope = id;
     }
+    else if (host_map_ != nullptr) {
+      obj_stack_.MergeMap(*host_map_);
+    }
+
+    if (profiler_ != nullptr) profiler_->Enter(frame_stack_.top().function_scope);
+
+    //Every frame pushed by machine is counted, including this one.
+    auto count_frame = [&]() -> void {
+      if (!collect_stats_) return;
+      stats.frames_pushed += 1;
+      if (frame_stack_.size() > stats.peak_depth) {
+        stats.peak_depth = frame_stack_.size();
+      }
+    };
+
+    count_frame();
 
     RuntimeFrame *frame = &frame_stack_.top();
     size_t size = code->size();
 
+    LoadSlots();
+
     //Refreshing loop tick state to make it work correctly.
     auto refresh_tick = [&]() -> void {
-      code = code_stack_.back();
+      code = &code_stack_.back().code->GetBytecode();
       size = code->size();
       frame = &frame_stack_.top();
     };
 
     auto update_stack_frame = [&](FunctionImpl &func) -> void {
       bool event_processing = frame->event_processing;
-      code_stack_.push_back(&func.GetCode());
-      frame_stack_.push(RuntimeFrame(func.GetId()));
+      code_stack_.push_back(func.GetCodeRecord());
+      frame_stack_.emplace(func.GetId());
+      if (profiler_ != nullptr) profiler_->Enter(func.GetId());
+      count_frame();
       obj_stack_.Push();
       obj_stack_.CreateObject(kStrUserFunc, Object(func.GetId()));
       obj_stack_.MergeMap(obj_map);
       obj_stack_.MergeMap(impl->GetClosureRecord());
       refresh_tick();
+      LoadSlots();
       frame->jump_offset = func.GetOffset();
       frame->event_processing = event_processing;
     };
@@ -1566,11 +1831,17 @@ namespace kagami {
       size_t jump_offset = frame_stack_.top().jump_offset;
       obj_map.Naturalize(obj_stack_.GetCurrent());
       frame_stack_.top() = RuntimeFrame(function_scope);
+      if (collect_stats_) stats.frames_reused += 1;
+      if (profiler_ != nullptr) {
+        profiler_->Exit();
+        profiler_->Enter(function_scope);
+      }
       obj_stack_.ClearCurrent();
       obj_stack_.CreateObject(kStrUserFunc, Object(function_scope));
       obj_stack_.MergeMap(obj_map);
       obj_stack_.MergeMap(impl->GetClosureRecord());
       refresh_tick();
+      LoadSlots();
       frame->jump_offset = jump_offset;
       frame->event_processing = event_processing;
     };
@@ -1578,14 +1849,20 @@ namespace kagami {
     auto tail_call = [&](FunctionImpl &func) -> void {
       bool event_processing = frame->event_processing;
       code_stack_.pop_back();
-      code_stack_.push_back(&func.GetCode());
+      code_stack_.push_back(func.GetCodeRecord());
       obj_map.Naturalize(obj_stack_.GetCurrent());
       frame_stack_.top() = RuntimeFrame(func.GetId());
+      if (collect_stats_) stats.frames_reused += 1;
+      if (profiler_ != nullptr) {
+        profiler_->Exit();
+        profiler_->Enter(func.GetId());
+      }
       obj_stack_.ClearCurrent();
       obj_stack_.CreateObject(kStrUserFunc, Object(func.GetId()));
       obj_stack_.MergeMap(obj_map);
       obj_stack_.MergeMap(impl->GetClosureRecord());
       refresh_tick();
+      LoadSlots();
       frame->jump_offset = func.GetOffset();
       frame->event_processing = event_processing;
     };
@@ -1604,10 +1881,40 @@ namespace kagami {
         break;
       }
 
+      //Script file is checked periodically, or while waiting for events.
+      if (reloader_ != nullptr && !invoking && frame_stack_.size() == 1) {
+        reload_ticks += 1;
+
+        if (freezing || reload_ticks >= kReloadPollStride) {
+          reload_ticks = 0;
+
+          if (reloader_->Poll()) {
+            ApplyReload();
+            refresh_tick();
+          }
+        }
+      }
+
 #ifndef _DISABLE_SDL_
       //window event handler
-      if ((!frame->event_processing && SDL_PollEvent(&event) != 0)
-        || (freezing && SDL_WaitEvent(&event) != 0)) {
+      //SDL is only asked for new events by the pump schedule, or when
+      //machine is waiting for them.
+      if (!frame->event_processing || freezing) {
+        pump_ticks += 1;
+
+        if (event_queue_.empty() && (freezing ||
+          pump_ticks >= pump_option.interval ||
+          (pump_ticks % kEventClockStride == 0 &&
+            SDL_GetTicks() - last_pump >= pump_option.budget))) {
+          PumpEvents(freezing);
+          pump_ticks = 0;
+          last_pump = SDL_GetTicks();
+        }
+      }
+
+      if ((!frame->event_processing || freezing) && !event_queue_.empty()) {
+        event = event_queue_.front();
+        event_queue_.pop_front();
         EventHandlerMark mark(event.window.windowID, event.type);
         auto it = event_list_.find(mark);
         if (it != event_list_.end()) {
@@ -1624,6 +1931,9 @@ namespace kagami {
 
         if (freezing) continue;
       }
+
+      //Waiting may time out for hot reloading
+      if (freezing) continue;
 #endif
 
       //switch to last stack frame
@@ -1639,45 +1949,80 @@ namespace kagami {
 
       //if (freezing) continue;
 
-      command = &(*code)[frame->idx];
+      inst = &(*code)[frame->idx];
+      args = code->GetOperands(*inst);
 
-      if (command->first.type == kRequestNull) {
+      if (inst->GetType() == kRequestNull) {
         trace::AddEvent("Frontend Panic.", kStateError);
         break;
       }
 
-      script_idx = command->first.idx;
-      frame->void_call = command->first.option.void_call;
+      script_idx = inst->line;
+      frame->void_call = inst->IsVoidCall();
+      if (profiler_ != nullptr) profiler_->Tick(script_idx);
 
       //Built-in machine commands.
-      if (command->first.type == kRequestCommand) {
-        MachineCommands(command->first.GetKeywordValue(), command->second, command->first);
-        
-        if (command->first.GetKeywordValue() == kKeywordReturn) {
-          refresh_tick();
-        }
+      //Commands are executed in a row until reaching a function call,
+      //a frame switching or a backward jump. Housekeeping of main loop
+      //(warnings, stop point, event polling) is done at these points only.
+      if (inst->GetType() == kRequestCommand) {
+        auto &command_table = GetCommandTable();
+        bool command_error = false;
+
+        while (true) {
+          auto token = inst->GetKeywordValue();
+          size_t last_idx = frame->idx;
+          if (collect_stats_) stats.commands[token] += 1;
+
+          if (dispatch_ == kDispatchTable) {
+            (this->*command_table[token])(args, *inst);
+          }
+          else {
+            MachineCommands(token, args, *inst);
+          }
 
-        if (frame->error) {
-          script_idx = command->first.idx;
-          break;
+          if (token == kKeywordReturn) {
+            refresh_tick();
+          }
+
+          if (frame->error) {
+            script_idx = inst->line;
+            command_error = true;
+            break;
+          }
+
+          frame->Steping();
+
+          if (token == kKeywordReturn || frame->warning || 
+            frame->idx <= last_idx || frame->idx >= size) break;
+
+          inst = &(*code)[frame->idx];
+
+          if (inst->GetType() != kRequestCommand) break;
+
+          args = code->GetOperands(*inst);
+          script_idx = inst->line;
+          frame->void_call = inst->IsVoidCall();
+          if (profiler_ != nullptr) profiler_->Tick(script_idx);
         }
 
-        frame->Steping();
+        if (command_error) break;
         continue;
       }
 
       obj_map.clear();
       //Query function(Interpreter built-in or user-defined)
-      if (command->first.type == kRequestExt) {
-        if (!FetchFunctionImpl(impl, command, obj_map)) {
+      if (inst->GetType() == kRequestExt) {
+        if (!FetchFunctionImpl(impl, *inst, obj_map)) {
           break;
         }
+        if (collect_stats_) stats.calls += 1;
       }
 
       //Build object map for function call expressed by command
-      GenerateArgs(*impl, command->second, obj_map);
+      GenerateArgs(*impl, args, obj_map);
       if (frame->error) {
-        script_idx = command->first.idx;
+        script_idx = inst->line;
         break;
       }
 
@@ -1723,7 +2068,7 @@ namespace kagami {
         continue;
       }
 
-      frame->RefreshReturnStack(msg.GetObj());
+      frame->RefreshReturnStack(msg.TakeObj());
       frame->Steping();
     }
 
@@ -1739,7 +2084,20 @@ namespace kagami {
       if (invoking) invoking_error = true;
     }
 
+    if (!invoking) {
+      error_ = frame->error || interface_error;
+      if (collect_stats_) DetachRuntimeStats(&stats_);
+
+      if (host_map_ != nullptr && !error_) {
+        for (auto &unit : obj_stack_.GetCurrent().GetContent()) {
+          (*host_map_)[unit.first] = unit.second.IsRef() ?
+            unit.second.Unpack() : unit.second;
+        }
+      }
+    }
+
     if (!invoking || (invoking && frame_stack_.size() != stop_point)) {
+      if (profiler_ != nullptr) profiler_->Exit();
       obj_stack_.Pop();
       frame_stack_.pop();
       code_stack_.pop_back();
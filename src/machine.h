@@ -5,6 +5,9 @@
 */
 #include "frontend.h"
 #include "management.h"
+#include "profiler.h"
+#include "hotreload.h"
+#include "stats.h"
 
 #define CHECK_PRINT_OPT()                          \
   if (p.find(kStrSwitchLine) != p.end()) {         \
@@ -14,8 +17,8 @@
 #define EXPECT_TYPE(_Map, _Item, _Type)            \
   if (!_Map.CheckTypeId(_Item, _Type))             \
     return Message(kCodeIllegalParam,              \
-    "Expect object type - " + _Type + ".",         \
-    kStateError)
+    "Expect object type - " +                      \
+    GetTypeName(_Type) + ".", kStateError)
 
 #define EXPECT(_State, _Mess)                      \
   if (!(_State)) return Message(kCodeIllegalParam, _Mess, kStateError)
@@ -29,7 +32,7 @@
 namespace kagami {
   using management::type::PlainComparator;
 
-  PlainType FindTypeCode(string type_id);
+  PlainType FindTypeCode(TypeId type_id);
   int64_t IntProducer(Object &obj);
   double FloatProducer(Object &obj);
   string StringProducer(Object &obj);
@@ -38,26 +41,22 @@ namespace kagami {
   std::string ws2s(const std::wstring &s);
   string ParseRawString(const string &src);
   void InitPlainTypes();
+  bool EvaluateConstant(Keyword op, Object &lhs, Object &rhs, Object &result);
+
+  /*
+    Result type of plain binary operation, indexed by plain type codes of
+    left and right operand. Row/column 0 is not used.
+  */
+  const PlainType kResultTypeTable[5][5] = {
+    { kNotPlainType, kNotPlainType, kNotPlainType, kNotPlainType, kNotPlainType },
+    { kNotPlainType, kPlainInt,     kPlainFloat,   kPlainString,  kPlainInt     },
+    { kNotPlainType, kPlainFloat,   kPlainFloat,   kPlainString,  kPlainFloat   },
+    { kNotPlainType, kPlainString,  kPlainString,  kPlainString,  kPlainString  },
+    { kNotPlainType, kPlainInt,     kPlainFloat,   kPlainString,  kPlainBool    }
+  };
 
-  using ResultTraitKey = pair<PlainType, PlainType>;
-  using TraitUnit = pair<ResultTraitKey, PlainType>;
-  const map<ResultTraitKey, PlainType> kResultDynamicTraits = {
-    TraitUnit(ResultTraitKey(kPlainInt, kPlainInt), kPlainInt),
-    TraitUnit(ResultTraitKey(kPlainInt, kPlainFloat), kPlainFloat),
-    TraitUnit(ResultTraitKey(kPlainInt, kPlainString), kPlainString),
-    TraitUnit(ResultTraitKey(kPlainInt, kPlainBool), kPlainInt),
-    TraitUnit(ResultTraitKey(kPlainFloat, kPlainFloat), kPlainFloat),
-    TraitUnit(ResultTraitKey(kPlainFloat, kPlainInt), kPlainFloat),
-    TraitUnit(ResultTraitKey(kPlainFloat, kPlainString), kPlainString),
-    TraitUnit(ResultTraitKey(kPlainFloat, kPlainBool), kPlainFloat),
-    TraitUnit(ResultTraitKey(kPlainString, kPlainString), kPlainString),
-    TraitUnit(ResultTraitKey(kPlainString, kPlainInt), kPlainString),
-    TraitUnit(ResultTraitKey(kPlainString, kPlainFloat), kPlainString),
-    TraitUnit(ResultTraitKey(kPlainString, kPlainBool), kPlainString),
-    TraitUnit(ResultTraitKey(kPlainBool, kPlainBool), kPlainBool),
-    TraitUnit(ResultTraitKey(kPlainBool, kPlainInt), kPlainInt),
-    TraitUnit(ResultTraitKey(kPlainBool, kPlainFloat), kPlainFloat),
-    TraitUnit(ResultTraitKey(kPlainBool, kPlainString), kPlainString)
+  const TypeId kPlainTypeIds[5] = {
+    kTypeNull, kTypeInt, kTypeFloat, kTypeString, kTypeBool
   };
 
   template <class ResultType, class Tx, class Ty, Keyword op>
@@ -194,13 +193,128 @@ namespace kagami {
   template <class Tx, Keyword op>
   using LogicBox = BinaryOpBox<bool, Tx, Tx, op>;
 
+  template <class T>
+  struct PlainTraits {};
+
+  template <>
+  struct PlainTraits<int64_t> {
+    static const TypeId kType = kTypeInt;
+    static int64_t Produce(Object &obj) { return IntProducer(obj); }
+  };
+
+  template <>
+  struct PlainTraits<double> {
+    static const TypeId kType = kTypeFloat;
+    static double Produce(Object &obj) { return FloatProducer(obj); }
+  };
+
+  template <>
+  struct PlainTraits<string> {
+    static const TypeId kType = kTypeString;
+    static string Produce(Object &obj) { return StringProducer(obj); }
+  };
+
+  template <>
+  struct PlainTraits<bool> {
+    static const TypeId kType = kTypeBool;
+    static bool Produce(Object &obj) { return BoolProducer(obj); }
+  };
+
+  constexpr bool IsMathOperator(Keyword op) {
+    return op == kKeywordPlus || op == kKeywordMinus ||
+      op == kKeywordTimes || op == kKeywordDivide;
+  }
+
+  constexpr bool IsIllegalStringOperator(Keyword op) {
+    return op != kKeywordPlus &&
+      op != kKeywordNotEqual &&
+      op != kKeywordEquals;
+  }
+
+  /*
+    Kernels of plain binary operators.
+    Operands are converted into result type T by producers. The exact
+    version is used when both operands are already T, and reads them
+    directly.
+  */
+  template <class T, Keyword op, bool exact>
+  Object BinaryKernel(Object &lhs, Object &rhs) {
+    if constexpr (std::is_same_v<T, string> && IsIllegalStringOperator(op)) {
+      return Object();
+    }
+    else if constexpr (IsMathOperator(op)) {
+      T result = exact ?
+        MathBox<T, op>().Do(lhs.Cast<T>(), rhs.Cast<T>()) :
+        MathBox<T, op>().Do(PlainTraits<T>::Produce(lhs), PlainTraits<T>::Produce(rhs));
+      return Object(result, PlainTraits<T>::kType);
+    }
+    else {
+      bool result = exact ?
+        LogicBox<T, op>().Do(lhs.Cast<T>(), rhs.Cast<T>()) :
+        LogicBox<T, op>().Do(PlainTraits<T>::Produce(lhs), PlainTraits<T>::Produce(rhs));
+      return Object(result, kTypeBool);
+    }
+  }
+
+  using BinaryKernelPointer = Object(*)(Object &, Object &);
+  using BinaryKernelTable = array<array<BinaryKernelPointer, 5>, 5>;
+
+  template <Keyword op>
+  BinaryKernelPointer SelectBinaryKernel(PlainType result, bool exact) {
+    switch (result) {
+    case kPlainInt:
+      return exact ? BinaryKernel<int64_t, op, true> : BinaryKernel<int64_t, op, false>;
+    case kPlainFloat:
+      return exact ? BinaryKernel<double, op, true> : BinaryKernel<double, op, false>;
+    case kPlainString:
+      return exact ? BinaryKernel<string, op, true> : BinaryKernel<string, op, false>;
+    case kPlainBool:
+      return exact ? BinaryKernel<bool, op, true> : BinaryKernel<bool, op, false>;
+    default:break;
+    }
+
+    return nullptr;
+  }
+
+  template <Keyword op>
+  BinaryKernelTable BuildBinaryKernelTable() {
+    BinaryKernelTable table;
+
+    for (int lhs = 0; lhs < 5; ++lhs) {
+      for (int rhs = 0; rhs < 5; ++rhs) {
+        table[lhs][rhs] = SelectBinaryKernel<op>(
+          kResultTypeTable[lhs][rhs], lhs == rhs);
+      }
+    }
+
+    return table;
+  }
+
+  template <Keyword op>
+  const BinaryKernelTable kBinaryKernels = BuildBinaryKernelTable<op>();
+
   const string kIteratorBehavior = "obj|step_forward|__compare";
   const string kContainerBehavior = "head|tail";
 
-  using CommandPointer = Command * ;
 #ifndef _DISABLE_SDL_
   using EventHandlerMark = pair<Uint32, Uint32>;
   using EventHandler = pair<EventHandlerMark, FunctionImpl>;
+
+  /*
+    Event pump of machine.
+    SDL event queue is drained into machine every 'interval' ticks of main
+    loop, or when 'budget' milliseconds have passed since last pumping.
+  */
+  struct EventPumpOption {
+    size_t interval;
+    Uint32 budget;
+  };
+
+  const size_t kDefaultEventInterval = 256;
+  const Uint32 kDefaultEventBudget = 8;
+  const size_t kEventClockStride = 32;
+
+  EventPumpOption &GetEventPumpOption();
 #endif
   class RuntimeFrame {
   public:
@@ -222,8 +336,10 @@ namespace kagami {
     stack<size_t> jump_stack;
     stack<size_t> branch_jump_stack;
     stack<Object> return_stack;
+    ObjectContainer *scope_base;
+    vector<ObjectPointer> slots;
 
-    RuntimeFrame(string scope = kStrRootScope) :
+    RuntimeFrame(const string &scope = kStrRootScope) :
       error(false),
       warning(false),
       activated_continue(false),
@@ -236,11 +352,13 @@ namespace kagami {
       jump_offset(0),
       idx(0),
       msg_string(),
-      function_scope(),
+      function_scope(scope),
       condition_stack(),
       jump_stack(),
       branch_jump_stack(),
-      return_stack() {}
+      return_stack(),
+      scope_base(nullptr),
+      slots() {}
 
     void Steping();
     void Goto(size_t taget_idx);
@@ -250,122 +368,229 @@ namespace kagami {
     void RefreshReturnStack(Object obj = Object());
   };
 
+  enum DispatchMode {
+    kDispatchSwitch,
+    kDispatchTable
+  };
+
+#if defined(_TABLE_DISPATCH_)
+  const DispatchMode kDefaultDispatchMode = kDispatchTable;
+#else
+  const DispatchMode kDefaultDispatchMode = kDispatchSwitch;
+#endif
+
   //Kisaragi Machine Class
   class Machine {
   private:
+    using CommandHandler = void (Machine::*)(OperandList &, const Instruction &);
+    using CommandTable = array<CommandHandler, kKeywordNull + 1>;
+
     void RecoverLastState();
-    bool IsTailRecursion(size_t idx, VMCode *code);
+    const Bytecode &GetCurrentBytecode() { return code_stack_.back().code->GetBytecode(); }
+    BytecodeState &GetCurrentState() { return *code_stack_.back().state; }
+    bool IsTailRecursion(size_t idx, VMCodePointer code);
     bool IsTailCall(size_t idx);
 
-    Object FetchPlainObject(Argument &arg);
-    Object FetchFunctionObject(string id);
-    Object FetchObject(Argument &arg, bool checking = false);
+    Object FetchPlainObject(const Operand &arg);
+    Object FetchFunctionObject(const string &id);
+    Object FetchObject(const Operand &arg, bool checking = false);
 
-    bool _FetchFunctionImpl(FunctionImplPointer &impl, string id, string type_id);
-    bool FetchFunctionImpl(FunctionImplPointer &impl, CommandPointer &command,
+    void LoadSlots();
+    void BindSlot(const Operand &arg, const string &id);
+
+    bool _FetchFunctionImpl(FunctionImplPointer &impl, const string &id, const string &type_id);
+    bool FetchFunctionImpl(FunctionImplPointer &impl, const Instruction &inst,
       ObjectMap &obj_map);
 
-    void ClosureCatching(ArgumentList &args, size_t nest_end, bool closure);
+    void ClosureCatching(OperandList &args, size_t nest_end, bool closure);
+    void ApplyReload();
 
     Message Invoke(Object obj, string id, 
       const initializer_list<NamedObject> &&args = {});
 
-    void CommandIfOrWhile(Keyword token, ArgumentList &args, size_t nest_end);
-    void CommandForEach(ArgumentList &args, size_t nest_end);
-    void ForEachChecking(ArgumentList &args, size_t nest_end);
-    void CommandCase(ArgumentList &args, size_t nest_end);
+    void CommandIfOrWhile(Keyword token, OperandList &args, const Instruction &inst);
+    void CommandForEach(OperandList &args, size_t nest_end);
+    void ForEachChecking(OperandList &args, size_t nest_end);
+    void CommandCase(OperandList &args, size_t nest_end);
     void CommandElse();
-    void CommandWhen(ArgumentList &args);
+    void CommandWhen(OperandList &args);
     void CommandContinueOrBreak(Keyword token, size_t escape_depth);
     void CommandConditionEnd();
     void CommandLoopEnd(size_t nest);
     void CommandForEachEnd(size_t nest);
 
-    void CommandHash(ArgumentList &args);
-    void CommandSwap(ArgumentList &args);
-    void CommandBind(ArgumentList &args, bool local_value);
-    void CommandDeliver(ArgumentList &args, bool local_value);
-    void CommandTypeId(ArgumentList &args);
-    void CommandMethods(ArgumentList &args);
-    void CommandExist(ArgumentList &args);
-    void CommandNullObj(ArgumentList &args);
-    void CommandDestroy(ArgumentList &args);
-    void CommandConvert(ArgumentList &args);
-    void CommandRefCount(ArgumentList &args);
+    void CommandHash(OperandList &args);
+    void CommandSwap(OperandList &args);
+    void CommandBind(OperandList &args, bool local_value);
+    void CommandOperateAndBind(OperandList &args, const Instruction &inst);
+    void BindObject(const Operand &dest, Object &rhs, bool local_value);
+    void CommandDeliver(OperandList &args, bool local_value);
+    void CommandTypeId(OperandList &args);
+    void CommandMethods(OperandList &args);
+    void CommandExist(OperandList &args);
+    void CommandNullObj(OperandList &args);
+    void CommandDestroy(OperandList &args);
+    void CommandConvert(OperandList &args);
+    void CommandRefCount(OperandList &args);
     void CommandTime();
     void CommandVersion();
     void CommandMachineCodeName();
 
     template <Keyword op_code>
-    void BinaryMathOperatorImpl(ArgumentList &args);
+    Object BinaryMathOperation(Object &lhs, Object &rhs, uint8_t &quick);
+
+    template <Keyword op_code>
+    Object BinaryLogicOperation(Object &lhs, Object &rhs, uint8_t &quick);
+
+    template <Keyword op_code>
+    void BinaryMathOperatorImpl(OperandList &args);
 
     template <Keyword op_code>
-    void BinaryLogicOperatorImpl(ArgumentList &args);
+    void BinaryLogicOperatorImpl(OperandList &args);
+
+    Object FusedOperation(const Operand &lhs_arg, const Operand &rhs_arg, const Instruction &inst);
 
-    void OperatorLogicNot(ArgumentList &args);
+    void OperatorLogicNot(OperandList &args);
 
-    void ExpList(ArgumentList &args);
-    void InitArray(ArgumentList &args);
+    void ExpList(OperandList &args);
+    void InitArray(OperandList &args);
 
-    void CommandReturn(ArgumentList &args);
+    void CommandReturn(OperandList &args);
 #ifndef _DISABLE_SDL_
-    void CommandHandle(ArgumentList &args);
-    void CommandWait(ArgumentList &args);
-    void CommandLeave(ArgumentList &args);
+    void CommandHandle(OperandList &args);
+    void CommandWait(OperandList &args);
+    void CommandLeave(OperandList &args);
 #endif
-    void MachineCommands(Keyword token, ArgumentList &args, Request &request);
-
-    void GenerateArgs(FunctionImpl &impl, ArgumentList &args, ObjectMap &obj_map);
-    void Generate_Normal(FunctionImpl &impl, ArgumentList &args, ObjectMap &obj_map);
-    void Generate_AutoSize(FunctionImpl &impl, ArgumentList &args, ObjectMap &obj_map);
-    void Generate_AutoFill(FunctionImpl &impl, ArgumentList &args, ObjectMap &obj_map);
+    template <Keyword token>
+    void CommandEntry(OperandList &args, const Instruction &inst);
+    static const CommandTable &GetCommandTable();
+    void MachineCommands(Keyword token, OperandList &args, const Instruction &inst);
+
+    void GenerateArgs(FunctionImpl &impl, OperandList &args, ObjectMap &obj_map);
+    void Generate_Normal(FunctionImpl &impl, OperandList &args, ObjectMap &obj_map);
+    void Generate_AutoSize(FunctionImpl &impl, OperandList &args, ObjectMap &obj_map);
+    void Generate_AutoFill(FunctionImpl &impl, OperandList &args, ObjectMap &obj_map);
 #ifndef _DISABLE_SDL_
     void LoadEventInfo(SDL_Event &event, ObjectMap &obj_map, FunctionImpl &impl);
+    void PumpEvents(bool wait);
 #endif
   private:
-    deque<VMCodePointer> code_stack_;
+    deque<CodeRecord> code_stack_;
+    BytecodeState entry_state_;
     stack<RuntimeFrame> frame_stack_;
     ObjectStack obj_stack_;
 #ifndef _DISABLE_SDL_
     map<EventHandlerMark, FunctionImpl> event_list_;
+    deque<SDL_Event> event_queue_;
 #endif
     bool hanging;
     bool freezing;
+    DispatchMode dispatch_;
+    Profiler *profiler_;
+    HotReloader *reloader_;
+    ObjectMap *host_map_;
+    RuntimeStats stats_;
+    bool collect_stats_;
+    bool error_;
 
   public:
     Machine() :
       code_stack_(),
+      entry_state_(),
       frame_stack_(),
       obj_stack_(),
 #ifndef _DISABLE_SDL_
       event_list_(),
+      event_queue_(),
 #endif
       hanging(false),
-      freezing(false) {}
+      freezing(false),
+      dispatch_(kDefaultDispatchMode),
+      profiler_(nullptr),
+      reloader_(nullptr),
+      host_map_(nullptr),
+      stats_(),
+      collect_stats_(false),
+      error_(false) {}
 
     Machine(const Machine &rhs) :
       code_stack_(rhs.code_stack_),
+      entry_state_(rhs.entry_state_),
       frame_stack_(rhs.frame_stack_),
       obj_stack_(rhs.obj_stack_),
 #ifndef _DISABLE_SDL_
       event_list_(),
+      event_queue_(),
 #endif
       hanging(false),
-      freezing(false) {}
+      freezing(false),
+      dispatch_(rhs.dispatch_),
+      profiler_(rhs.profiler_),
+      reloader_(rhs.reloader_),
+      host_map_(rhs.host_map_),
+      stats_(),
+      collect_stats_(rhs.collect_stats_),
+      error_(false) {
+      for (auto &unit : code_stack_) {
+        if (unit.state == &rhs.entry_state_) unit.state = &entry_state_;
+      }
+    }
 
     Machine(const Machine &&rhs) :
       Machine(rhs) {}
 
-    Machine(VMCode &ir) :
+    //Code may be shared with other machines, it's never written here
+    Machine(const VMCode &ir) :
       code_stack_(),
+      entry_state_(ir.GetBytecode()),
       frame_stack_(),
       obj_stack_(),
 #ifndef _DISABLE_SDL_
       event_list_(), 
+      event_queue_(),
 #endif
       hanging(false), 
-      freezing(false) {
-      code_stack_.push_back(&ir);
+      freezing(false),
+      dispatch_(kDefaultDispatchMode),
+      profiler_(nullptr),
+      reloader_(nullptr),
+      host_map_(nullptr),
+      stats_(),
+      collect_stats_(false),
+      error_(false) {
+      code_stack_.push_back(CodeRecord{ &ir, &entry_state_ });
+    }
+
+    void SetDispatchMode(DispatchMode mode) {
+      dispatch_ = mode;
+    }
+
+    void SetProfiler(Profiler *profiler) {
+      profiler_ = profiler;
+    }
+
+    //Changed functions are swapped in while script is running
+    void SetReloader(HotReloader *reloader) {
+      reloader_ = reloader;
+    }
+
+    //Objects of host map are created in root scope before running, and
+    //root scope is written back into it after script is finished.
+    void SetHostMap(ObjectMap *p) {
+      host_map_ = p;
+    }
+
+    //Counters are collected only if it's set, see RuntimeStats
+    void SetStats(bool collect) {
+      collect_stats_ = collect;
+    }
+
+    const RuntimeStats &GetStats() const {
+      return stats_;
+    }
+
+    bool HasError() const {
+      return error_;
     }
 
     void SetPreviousStack(ObjectStack &prev) {
@@ -373,7 +598,7 @@ namespace kagami {
     }
 
     void Run(bool invoking = false, string id = "", 
-      VMCodePointer ptr = nullptr, ObjectMap *p = nullptr, 
+      CodeRecord record = CodeRecord{ nullptr, nullptr }, ObjectMap *p = nullptr, 
       ObjectMap *closure_record = nullptr);
   };
 
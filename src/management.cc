@@ -1,4 +1,5 @@
 #include "management.h"
+#include "stats.h"
 
 namespace kagami::management {
 ///////////////////////////////////////////////////////////////
@@ -14,6 +15,15 @@ namespace kagami::management {
     return cache;
   }
 
+  //Changed on every update of function table, call site caches holding
+  //older value will be dropped.
+  uint64_t &ImplEpoch() {
+    static uint64_t epoch = 1;
+    return epoch;
+  }
+
+  uint64_t GetImplEpoch() { return ImplEpoch(); }
+
   void BuildFunctionImplCache(string domain) {
     auto &base = GetFunctionImplCache();
     auto &col = GetFunctionImplCollections().at(domain);
@@ -36,9 +46,10 @@ namespace kagami::management {
     }
 
     BuildFunctionImplCache(domain);
+    ImplEpoch() += 1;
   }
 
-  FunctionImpl *FindFunction(string id, string domain) {
+  FunctionImpl *FindFunction(const string &id, const string &domain) {
     auto &cache = GetFunctionImplCache();
     auto it = cache.find(domain);
 
@@ -75,7 +86,7 @@ namespace kagami::management {
     return CreateConstantObject(id, object);
   }
 
-  Object GetConstantObject(string id) {
+  Object GetConstantObject(const string &id) {
     ObjectContainer &base = GetConstantBase();
     auto ptr = base.Find(id);
 
@@ -92,45 +103,49 @@ namespace kagami::management {
 
 namespace kagami::management::type {
   auto &GetObjectTraitsCollection() {
-    static unordered_map<string, ObjectTraits> base;
+    static vector<unique_ptr<ObjectTraits>> base;
     return base;
   }
 
-  vector<string> GetMethods(string id) {
+  ObjectTraits *FindObjectTraits(TypeId type) {
+    auto &base = GetObjectTraitsCollection();
+    return type < base.size() ? base[type].get() : nullptr;
+  }
+
+  vector<string> GetMethods(TypeId type) {
     vector<string> result;
-    const auto it = GetObjectTraitsCollection().find(id);
+    auto *traits = FindObjectTraits(type);
 
-    if (it != GetObjectTraitsCollection().end()) {
-      result = it->second.GetMethods();
+    if (traits != nullptr) {
+      result = traits->GetMethods();
     }
     return result;
   }
 
-  bool CheckMethod(string func_id, string domain) {
+  bool CheckMethod(string func_id, TypeId domain) {
     bool result = false;
-    const auto it = GetObjectTraitsCollection().find(domain);
+    auto *traits = FindObjectTraits(domain);
 
-    if (it != GetObjectTraitsCollection().end()) {
-      result = find_in_vector(func_id, it->second.GetMethods());
+    if (traits != nullptr) {
+      result = find_in_vector(func_id, traits->GetMethods());
     }
 
     return result;
   }
 
   size_t GetHash(Object &obj) {
-    auto &base = GetObjectTraitsCollection();
-    const auto it = base.find(obj.GetTypeId());
-    auto hasher = it->second.GetHasher();
+    if (obj.IsScalar()) return obj.GetScalarHash();
+
+    auto hasher = FindObjectTraits(obj.GetType())->GetHasher();
     return hasher(obj.Get());
   }
 
   bool IsHashable(Object &obj) {
     bool result = false;
-    auto &base = GetObjectTraitsCollection();
-    const auto it = base.find(obj.GetTypeId());
+    auto *traits = FindObjectTraits(obj.GetType());
 
-    if (it != base.end()) {
-      result = (it->second.GetHasher() != nullptr);
+    if (traits != nullptr) {
+      result = (traits->GetHasher() != nullptr);
     }
 
     return result;
@@ -138,18 +153,21 @@ namespace kagami::management::type {
 
   bool IsCopyable(Object &obj) {
     bool result = false;
-    auto &base = GetObjectTraitsCollection();
-    const auto it = base.find(obj.GetTypeId());
+    auto *traits = FindObjectTraits(obj.GetType());
 
-    if (it != base.end()) {
-      result = (it->second.GetDeliver() != ShallowDelivery);
+    if (traits != nullptr) {
+      result = (traits->GetDeliver() != ShallowDelivery);
     }
 
     return result;
   }
 
   void CreateObjectTraits(string id, ObjectTraits temp) {
-    GetObjectTraitsCollection().insert(pair<string, ObjectTraits>(id, temp));
+    auto &base = GetObjectTraitsCollection();
+    TypeId type = InternTypeId(id);
+
+    if (type >= base.size()) base.resize(type + 1);
+    if (base[type] == nullptr) base[type] = make_unique<ObjectTraits>(temp);
   }
 
   Object CreateObjectCopy(Object &object) {
@@ -157,40 +175,52 @@ namespace kagami::management::type {
       return object;
     }
 
+    if (object.IsScalar()) {
+      Object result(object.Unpack());
+      return result.RemoveDeliverFlag();
+    }
+
+    OBJECT_STATS_COUNT(object_copies);
+
     Object result;
-    const auto it = GetObjectTraitsCollection().find(object.GetTypeId());
-    if (it != GetObjectTraitsCollection().end()) {
-      auto deliver = it->second.GetDeliver();
-      result.PackContent(deliver(object.Get()), object.GetTypeId());
+    auto *traits = FindObjectTraits(object.GetType());
+    if (traits != nullptr) {
+      auto deliver = traits->GetDeliver();
+      result.PackContent(deliver(object.Get()), object.GetType());
     }
 
     return result;
   }
 
-  bool CheckBehavior(Object obj, string method_str) {
-    auto obj_methods = GetMethods(obj.GetTypeId());
-    auto sample = BuildStringVector(method_str);
-    bool result = true;
+  //Method list is walked in place, nothing is copied for every check.
+  bool CheckBehavior(Object &obj, const string &method_str) {
+    static const vector<string> empty;
+    auto *traits = FindObjectTraits(obj.GetType());
+    auto &obj_methods = traits != nullptr ? traits->GetMethods() : empty;
+    string_view rest(method_str);
 
-    for (auto &unit : sample) {
-      if (!find_in_vector(unit, obj_methods)) {
-        result = false;
-        break;
+    while (!rest.empty()) {
+      auto pos = rest.find('|');
+      auto unit = rest.substr(0, pos);
+      rest = pos == string_view::npos ? string_view() : rest.substr(pos + 1);
+
+      if (std::find(obj_methods.begin(), obj_methods.end(), unit) == obj_methods.end()) {
+        return false;
       }
     }
 
-    return result;
+    return true;
   }
 
   bool CompareObjects(Object &lhs, Object &rhs) {
-    if (lhs.GetTypeId() != rhs.GetTypeId()) return false;
-    auto &collection = GetObjectTraitsCollection();
-    const auto it = collection.find(lhs.GetTypeId());
+    if (lhs.GetType() != rhs.GetType()) return false;
+    auto *traits = FindObjectTraits(lhs.GetType());
     bool value = false;
 
-    if (it != collection.end()) {
-      auto comparator = it->second.GetComparator();
+    if (traits != nullptr) {
+      auto comparator = traits->GetComparator();
       if (comparator != nullptr) value = comparator(lhs, rhs);
+      else if (lhs.IsScalar()) value = lhs.CompareScalar(rhs);
       else value = (lhs.Get() == rhs.Get());
     }
 
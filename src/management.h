@@ -6,11 +6,12 @@ namespace kagami::management {
   using FunctionHashMap = unordered_map<string, FunctionImpl *>;
 
   void CreateImpl(FunctionImpl impl, string domain = kTypeIdNull);
-  FunctionImpl *FindFunction(string id, string domain = kTypeIdNull);
+  FunctionImpl *FindFunction(const string &id, const string &domain = kTypeIdNull);
+  uint64_t GetImplEpoch();
 
   Object *CreateConstantObject(string id, Object &object);
   Object *CreateConstantObject(string id, Object &&object);
-  Object GetConstantObject(string id);
+  Object GetConstantObject(const string &id);
 }
 
 namespace kagami::management::type {
@@ -19,14 +20,14 @@ namespace kagami::management::type {
     return lhs.Cast<T>() == rhs.Cast<T>();
   }
 
-  vector<string> GetMethods(string id);
-  bool CheckMethod(string func_id, string domain);
+  vector<string> GetMethods(TypeId type);
+  bool CheckMethod(string func_id, TypeId domain);
   size_t GetHash(Object &obj);
   bool IsHashable(Object &obj);
   bool IsCopyable(Object &obj);
   void CreateObjectTraits(string id, ObjectTraits temp);
   Object CreateObjectCopy(Object &object);
-  bool CheckBehavior(Object obj, string method_str);
+  bool CheckBehavior(Object &obj, const string &method_str);
   bool CompareObjects(Object &lhs, Object &rhs);
 
   class ObjectTraitsSetup {
@@ -99,8 +100,11 @@ namespace std {
 }
 
 namespace kagami {
-  using ObjectTable = unordered_map<Object, Object>;
+  using TableBuffer = unordered_map<Object, Object>;
+  using ObjectTable = CopyOnWrite<TableBuffer>;
   using ManagedTable = shared_ptr<ObjectTable>;
+
+  shared_ptr<TableBuffer> CloneBuffer(const TableBuffer &src);
 }
 
 #define EXPORT_CONSTANT(ID) management::CreateConstantObject(#ID, Object(ID))
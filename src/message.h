@@ -27,55 +27,77 @@ namespace kagami {
     kCodeBadExpression = -5
   };
 
+  /*
+    Result of native function.
+    Result object is stored inside the message, so returning a value from
+    builtin does not allocate anything more than the object itself. Detail
+    string is only needed by errors, warnings and interface calls, and it is
+    allocated when it is set.
+  */
   class Message {
   private:
     StateLevel level_;
-    string detail_;
     StateCode code_;
-    shared_ptr<void> object_;
+    shared_ptr<string> detail_;
+    optional<Object> object_;
     size_t idx_;
 
   public:
     Message() :
       level_(kStateNormal), 
-      detail_(""), 
       code_(kCodeSuccess), 
+      detail_(), 
+      object_(),
       idx_(0) {}
 
     Message(const Message &msg) :
       level_(msg.level_),
-      detail_(msg.detail_),
       code_(msg.code_),
+      detail_(msg.detail_),
       object_(msg.object_),
       idx_(msg.idx_) {}
 
-    Message(const Message &&msg) :
-      Message(msg) {}
+    Message(Message &&msg) noexcept :
+      level_(msg.level_),
+      code_(msg.code_),
+      detail_(std::move(msg.detail_)),
+      object_(std::move(msg.object_)),
+      idx_(msg.idx_) {}
 
     Message(StateCode code, string detail, StateLevel level = kStateNormal) :
       level_(level), 
-      detail_(detail), 
       code_(code), 
+      detail_(MakePooled<string>(detail)), 
+      object_(),
       idx_(0) {}
 
     Message(string detail) :
       level_(kStateNormal), 
       code_(kCodeObject), 
-      detail_(""), 
-      object_(make_shared<Object>(detail)),
+      detail_(), 
+      object_(std::in_place, detail),
       idx_(0) {}
 
+    //Object::operator=() does not keep reference counter of referenced
+    //object, so result object is always constructed again.
     Message &operator=(Message &msg) {
       level_ = msg.level_;
       detail_ = msg.detail_;
       code_ = msg.code_;
-      object_ = msg.object_;
+      object_.reset();
+      if (msg.object_.has_value()) object_.emplace(*msg.object_);
       idx_ = msg.idx_;
       return *this;
     }
 
-    Message &operator=(Message &&msg) {
-      return this->operator=(msg);
+    Message &operator=(Message &&msg) noexcept {
+      level_ = msg.level_;
+      detail_ = std::move(msg.detail_);
+      code_ = msg.code_;
+      object_.reset();
+      if (msg.object_.has_value()) object_.emplace(std::move(*msg.object_));
+      idx_ = msg.idx_;
+      return *this;
     }
 
     StateLevel GetLevel() const {
@@ -86,8 +108,9 @@ namespace kagami {
       return code_; 
     }
 
-    string GetDetail() const { 
-      return detail_; 
+    const string &GetDetail() const { 
+      static const string empty;
+      return detail_ != nullptr ? *detail_ : empty; 
     }
 
     size_t GetIndex() const { 
@@ -95,44 +118,42 @@ namespace kagami {
     }
 
     Object GetObj() const {
-      if (code_ != kCodeObject) return Object();
-      return *static_pointer_cast<Object>(object_);
+      if (code_ != kCodeObject || !object_.has_value()) return Object();
+      return *object_;
+    }
+
+    //Object is moved out, for caller who drops the message afterwards
+    Object TakeObj() {
+      if (code_ != kCodeObject || !object_.has_value()) return Object();
+      return std::move(*object_);
     }
 
     Message &SetObject(Object &object) {
-      object_ = make_shared<Object>(object);
+      object_.emplace(object);
       code_ = kCodeObject;
       return *this;
     }
 
     Message &SetObject(bool value) {
-      object_ = make_shared<Object>(
-        make_shared<bool>(value), kTypeIdBool
-      );
+      object_.emplace(value, kTypeBool);
       code_ = kCodeObject;
       return *this;
     }
 
     Message &SetObject(int64_t value) {
-      object_ = make_shared<Object>(
-        make_shared<int64_t>(value), kTypeIdInt
-        );
+      object_.emplace(value, kTypeInt);
       code_ = kCodeObject;
       return *this;
     }
 
     Message &SetObject(double value) {
-      object_ = make_shared<Object>(
-        make_shared<double>(value), kTypeIdFloat
-        );
+      object_.emplace(value, kTypeFloat);
       code_ = kCodeObject;
       return *this;
     }
 
     Message &SetObject(string value) {
-      object_ = make_shared<Object>(
-        make_shared<string>(value), kTypeIdString
-        );
+      object_.emplace(MakePooled<string>(value), kTypeString);
       code_ = kCodeObject;
       return *this;
     }
@@ -152,7 +173,7 @@ namespace kagami {
     }
 
     Message &SetDetail(const string &detail) {
-      detail_ = detail;
+      detail_ = MakePooled<string>(detail);
       return *this;
     }
 
@@ -163,11 +184,10 @@ namespace kagami {
 
     void Clear() {
       level_ = kStateNormal;
-      detail_.clear();
-      detail_.shrink_to_fit();
+      detail_.reset();
       code_ = kCodeSuccess;
       object_.reset();
       idx_ = 0;
     }
   };
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #include "object.h"
+#include "stats.h"
 
 namespace kagami {
   vector<string> BuildStringVector(string source) {
@@ -16,6 +17,46 @@ namespace kagami {
     return result;
   }
 
+  auto &GetTypeRegistry() {
+    static deque<string> base = {
+      kTypeIdNull, kTypeIdInt, kTypeIdFloat, kTypeIdBool, kTypeIdString,
+      kTypeIdWideString, kTypeIdArray, kTypeIdInStream, kTypeIdOutStream,
+      kTypeIdRegex, kTypeIdFunction, kTypeIdIterator, kTypeIdPair,
+      kTypeIdTable, kTypeIdStruct
+    };
+    return base;
+  }
+
+  auto &GetTypeIndex() {
+    static unordered_map<string, TypeId> index;
+    auto &registry = GetTypeRegistry();
+
+    if (index.empty()) {
+      for (size_t idx = 0; idx < registry.size(); ++idx) {
+        index.emplace(registry[idx], static_cast<TypeId>(idx));
+      }
+    }
+
+    return index;
+  }
+
+  TypeId InternTypeId(const string &type_name) {
+    auto &index = GetTypeIndex();
+    auto it = index.find(type_name);
+
+    if (it != index.end()) return it->second;
+
+    auto &registry = GetTypeRegistry();
+    TypeId type = static_cast<TypeId>(registry.size());
+    registry.push_back(type_name);
+    index.emplace(type_name, type);
+    return type;
+  }
+
+  const string &GetTypeName(TypeId type) {
+    return GetTypeRegistry()[type];
+  }
+
   size_t PointerHasher(shared_ptr<void> ptr) {
     auto hasher = std::hash<shared_ptr<void>>();
     return hasher(ptr);
@@ -25,6 +66,57 @@ namespace kagami {
     return target;
   }
 
+  //For payload which is never changed in place after creation (string).
+  //Copies share it just like ShallowDelivery, but type is still copyable.
+  shared_ptr<void> SharedDelivery(shared_ptr<void> target) {
+    return target;
+  }
+
+  shared_ptr<void> Object::BoxScalar() const {
+    shared_ptr<void> result;
+
+    switch (tag_) {
+    case kScalarInt:result = MakePooled<int64_t>(scalar_.int_value); break;
+    case kScalarFloat:result = MakePooled<double>(scalar_.float_value); break;
+    case kScalarBool:result = MakePooled<bool>(scalar_.bool_value); break;
+    default:break;
+    }
+
+    return result;
+  }
+
+  size_t Object::GetScalarHash() const {
+    if (mode_ == kObjectRef) return real_dest_->GetScalarHash();
+
+    size_t result = 0;
+
+    switch (tag_) {
+    case kScalarInt:result = std::hash<int64_t>()(scalar_.int_value); break;
+    case kScalarFloat:result = std::hash<double>()(scalar_.float_value); break;
+    case kScalarBool:result = std::hash<bool>()(scalar_.bool_value); break;
+    default:break;
+    }
+
+    return result;
+  }
+
+  bool Object::CompareScalar(const Object &obj) const {
+    if (mode_ == kObjectRef) return real_dest_->CompareScalar(obj);
+    if (obj.mode_ == kObjectRef) return CompareScalar(*obj.real_dest_);
+    if (tag_ != obj.tag_) return false;
+
+    bool result = false;
+
+    switch (tag_) {
+    case kScalarInt:result = scalar_.int_value == obj.scalar_.int_value; break;
+    case kScalarFloat:result = scalar_.float_value == obj.scalar_.float_value; break;
+    case kScalarBool:result = scalar_.bool_value == obj.scalar_.bool_value; break;
+    default:break;
+    }
+
+    return result;
+  }
+
   Object &Object::operator=(const Object &object) {
     if (object.mode_ == kObjectRef) {
       real_dest_ = object.real_dest_;
@@ -35,25 +127,31 @@ namespace kagami {
       ptr_ = object.ptr_;
     }
 
-    type_id_ = object.type_id_;
+    tag_ = object.tag_;
+    scalar_ = object.scalar_;
+
+    type_ = object.type_;
     mode_ = object.mode_;
     do_not_copy_ = object.do_not_copy_;
     return *this;
   }
 
-  Object &Object::PackContent(shared_ptr<void> ptr, string type_id) {
+  Object &Object::PackContent(shared_ptr<void> ptr, TypeId type) {
     if (mode_ == kObjectRef) {
-      return real_dest_->PackContent(ptr, type_id);
+      return real_dest_->PackContent(ptr, type);
     }
 
     ptr_ = ptr;
-    type_id_ = type_id;
+    tag_ = kScalarNull;
+    type_ = type;
     return *this;
   }
 
   Object &Object::swap(Object &obj) {
     ptr_.swap(obj.ptr_);
-    std::swap(type_id_, obj.type_id_);
+    std::swap(tag_, obj.tag_);
+    std::swap(scalar_, obj.scalar_);
+    std::swap(type_, obj.type_);
     std::swap(mode_, obj.mode_);
     std::swap(do_not_copy_, obj.do_not_copy_);
     std::swap(real_dest_, obj.real_dest_);
@@ -62,7 +160,8 @@ namespace kagami {
 
   Object &Object::PackObject(Object &object) {
     ptr_.reset();
-    type_id_ = object.type_id_;
+    tag_ = kScalarNull;
+    type_ = object.type_;
     mode_ = kObjectRef;
 
     if (!object.IsRef()) {
@@ -76,103 +175,184 @@ namespace kagami {
     return *this;
   }
 
-  void ObjectContainer::BuildCache() {
-    dest_map_.clear();
-    const auto begin = base_.begin(), end = base_.end();
-    for (auto it = begin; it != end; ++it) {
-      dest_map_.insert(make_pair(it->first, &it->second));
+  NamedObject *ObjectContainer::Lookup(const string &id) const {
+    if (id.empty()) return nullptr;
+
+    if (!indexed_) {
+      for (size_t idx = 0; idx < size_; ++idx) {
+        auto &entry = At(idx);
+        if (entry.first == id) return &entry;
+      }
+
+      return nullptr;
+    }
+
+    const size_t mask = index_.size() - 1;
+    size_t pos = std::hash<string>()(id) & mask;
+
+    while (index_[pos] != 0) {
+      auto &entry = At(index_[pos] - 1);
+      if (entry.first == id) return &entry;
+      pos = (pos + 1) & mask;
     }
+
+    return nullptr;
   }
 
-  bool ObjectContainer::Add(string id, Object source) {
-    if (CheckObject(id)) return false;
-    base_.insert(NamedObject(id, source));
-    BuildCache();
-    return true;
+  void ObjectContainer::IndexEntry(size_t idx) {
+    const size_t mask = index_.size() - 1;
+    size_t pos = std::hash<string>()(At(idx).first) & mask;
+
+    while (index_[pos] != 0) pos = (pos + 1) & mask;
+
+    index_[pos] = static_cast<uint32_t>(idx + 1);
   }
 
-  bool ObjectContainer::Dispose(string id) {
-    auto it = base_.find(id);
-    bool result = it != base_.end();
+  //Keep load factor of index under 1/2, holes are dropped here.
+  void ObjectContainer::BuildIndex() {
+    size_t capacity = 16;
+    while (capacity < size_ * 2 + 2) capacity *= 2;
+
+    index_.assign(capacity, 0);
+    indexed_ = true;
 
-    if (result) {
-      base_.erase(it);
-      BuildCache();
+    for (size_t idx = 0; idx < size_; ++idx) {
+      if (!At(idx).first.empty()) IndexEntry(idx);
     }
+  }
 
-    return result;
+  void ObjectContainer::CopyFrom(const ObjectContainer &container) {
+    for (auto &unit : container) {
+      Add(unit.first, unit.second);
+    }
   }
 
-  Object *ObjectContainer::Find(string id, bool forward_seeking) {
-    if (base_.empty() && prev_ == nullptr) return nullptr;
+  bool ObjectContainer::Add(string id, Object source) {
+    if (id.empty() || Lookup(id) != nullptr) return false;
 
-    ObjectPointer ptr = nullptr;
+    if (size_ == chunks_.size() * kScopeChunkSize) {
+      chunks_.emplace_back(std::make_unique<Chunk>());
+    }
 
-    if (!base_.empty()) {
-      auto it = dest_map_.find(id);
+    new (&At(size_)) NamedObject(std::move(id), source);
+    size_ += 1;
+    live_ += 1;
 
-      if (it != dest_map_.end()) {
-        ptr = it->second;
-      }
-      else {
-        if (prev_ != nullptr && forward_seeking) {
-          ptr = prev_->Find(id);
-        }
-      }
+    if (indexed_) {
+      if (size_ * 2 > index_.size()) BuildIndex();
+      else IndexEntry(size_ - 1);
     }
-    else if (prev_ != nullptr && forward_seeking) {
-      ptr = prev_->Find(id);
+    else if (size_ > kScopeLinearLimit) {
+      BuildIndex();
     }
 
-    return ptr;
+    return true;
+  }
+
+  bool ObjectContainer::Dispose(string id) {
+    auto *entry = Lookup(id);
+
+    if (entry == nullptr) return false;
+
+    //Entry becomes a hole, slot in index is left as tombstone
+    entry->~NamedObject();
+    new (entry) NamedObject();
+    live_ -= 1;
+    return true;
+  }
+
+  Object *ObjectContainer::Find(const string &id, bool forward_seeking) {
+    //Counted once for every scope level visited, previous levels are
+    //visited by recursion below.
+    OBJECT_STATS_COUNT(scope_walks);
+
+    auto *entry = Lookup(id);
+
+    if (entry != nullptr) return &entry->second;
+
+    if (prev_ != nullptr && forward_seeking) return prev_->Find(id);
+
+    return nullptr;
   }
 
   bool ObjectContainer::FindDest(Object *ptr) {
-    bool result = false;
-    for (const auto &unit : dest_map_) {
-      if (unit.second == ptr) result = true;
+    for (auto &unit : *this) {
+      if (&unit.second == ptr) return true;
     }
-    return result;
+
+    return false;
   }
 
-  string ObjectContainer::FindDomain(string id, bool forward_seeking) {
-    if (base_.empty() && prev_ == nullptr) return kTypeIdNull;
+  string ObjectContainer::FindDomain(const string &id, bool forward_seeking) {
+    if (live_ == 0 && prev_ == nullptr) return kTypeIdNull;
+
+    auto *entry = Lookup(id);
 
-    string result;
+    if (entry != nullptr) return entry->second.GetTypeId();
 
-    if (!base_.empty()) {
-      auto it = dest_map_.find(id);
+    if (prev_ != nullptr && forward_seeking) return prev_->FindDomain(id);
 
-      if (it != dest_map_.end()) {
-        result = it->second->GetTypeId();
+    return string();
+  }
+
+  void ObjectContainer::ClearExcept(const string &exceptions) {
+    auto excepted = [&exceptions](const string &id) -> bool {
+      string_view rest(exceptions);
+
+      while (!id.empty() && !rest.empty()) {
+        auto pos = rest.find('|');
+        if (rest.substr(0, pos) == id) return true;
+        rest = pos == string_view::npos ? string_view() : rest.substr(pos + 1);
       }
-      else {
-        if (prev_ != nullptr && forward_seeking) {
-          result = prev_->FindDomain(id);
-        }
+
+      return false;
+    };
+    size_t kept = 0;
+
+    while (kept < size_ && excepted(At(kept).first)) ++kept;
+
+    bool in_place = true;
+    for (size_t idx = kept; idx < size_ && in_place; ++idx) {
+      in_place = !excepted(At(idx).first);
+    }
+
+    //Objects like iterator of for-each are created first, so they are
+    //usually kept where they are and only the rest is dropped.
+    if (in_place) {
+      for (size_t idx = kept; idx < size_; ++idx) {
+        At(idx).~NamedObject();
       }
+
+      size_ = kept;
+      live_ = kept;
+      indexed_ = false;
+      if (size_ > kScopeLinearLimit) BuildIndex();
+      return;
     }
-    else if (prev_ != nullptr && forward_seeking) {
-      result = prev_->FindDomain(id); 
+
+    vector<NamedObject> dest;
+
+    for (size_t idx = 0; idx < size_; ++idx) {
+      auto &entry = At(idx);
+      if (excepted(entry.first)) dest.push_back(entry);
     }
 
-    return result;
-  }
+    Clear();
 
-  void ObjectContainer::ClearExcept(string exceptions) {
-    map<string, Object> dest;
-    map<string, Object>::iterator it;
-    auto obj_list = BuildStringVector(exceptions);
+    for (auto &unit : dest) {
+      Add(unit.first, unit.second);
+    }
+  }
 
-    for (auto &unit : obj_list) {
-      it = base_.find(unit);
-      if (it != base_.end()) {
-        dest.insert(*it);
-      }
+  //Chunks are kept, so refilling scope in next round allocates nothing.
+  void ObjectContainer::Clear() {
+    for (size_t idx = 0; idx < size_; ++idx) {
+      At(idx).~NamedObject();
     }
 
-    base_.swap(dest);
-    BuildCache();
+    size_ = 0;
+    live_ = 0;
+    indexed_ = false;
   }
 
   ObjectMap &ObjectMap::operator=(const initializer_list<NamedObject> &rhs) {
@@ -211,7 +391,9 @@ namespace kagami {
     }
   }
 
-  Object *ObjectStack::Find(string id) {
+  Object *ObjectStack::Find(const string &id) {
+    OBJECT_STATS_COUNT(lookups);
+
     if (base_.empty() && prev_ == nullptr) return nullptr;
     ObjectPointer ptr = base_.back().Find(id);
 
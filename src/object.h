@@ -1,5 +1,5 @@
 #pragma once
-#include "common.h"
+#include "pool.h"
 
 namespace kagami {
   class Object;
@@ -17,6 +17,9 @@ namespace kagami {
   
   vector<string> BuildStringVector(string source);
 
+  TypeId InternTypeId(const string &type_name);
+  const string &GetTypeName(TypeId type);
+
   enum ObjectMode {
     kObjectNormal    = 1,
     kObjectRef       = 2,
@@ -35,10 +38,11 @@ namespace kagami {
   template <class T>
   shared_ptr<void> PlainDeliveryImpl(shared_ptr<void> target) {
     T temp(*static_pointer_cast<T>(target));
-    return make_shared<T>(temp);
+    return MakePooled<T>(temp);
   }
 
   shared_ptr<void> ShallowDelivery(shared_ptr<void> target);
+  shared_ptr<void> SharedDelivery(shared_ptr<void> target);
 
   class ObjectTraits {
   private:
@@ -66,14 +70,50 @@ namespace kagami {
     DeliveryImpl GetDeliver() { return dlvy_; }
   };
 
+  enum ScalarTag {
+    kScalarNull,
+    kScalarInt,
+    kScalarFloat,
+    kScalarBool
+  };
+
+  union ScalarValue {
+    int64_t int_value;
+    double float_value;
+    bool bool_value;
+  };
+
+  /*
+    Values of int, float and bool are stored inline without heap allocation.
+    Other types are managed by ptr_.
+  */
   class Object {
   private:
     ObjectPointer real_dest_;
     ObjectMode mode_;
     bool do_not_copy_;
+    ScalarTag tag_;
+    ScalarValue scalar_;
     int64_t ref_count_;
     shared_ptr<void> ptr_;
-    string type_id_;
+    TypeId type_;
+
+    shared_ptr<void> BoxScalar() const;
+
+    template <class Tx>
+    Tx *GetScalar() {
+      if constexpr (std::is_same_v<Tx, int64_t>) {
+        if (tag_ == kScalarInt) return &scalar_.int_value;
+      }
+      else if constexpr (std::is_same_v<Tx, double>) {
+        if (tag_ == kScalarFloat) return &scalar_.float_value;
+      }
+      else if constexpr (std::is_same_v<Tx, bool>) {
+        if (tag_ == kScalarBool) return &scalar_.bool_value;
+      }
+
+      return nullptr;
+    }
 
   public:
     ~Object() {
@@ -86,17 +126,21 @@ namespace kagami {
       real_dest_(nullptr),
       mode_(kObjectNormal),
       do_not_copy_(false),
+      tag_(kScalarNull),
+      scalar_(),
       ref_count_(0),
       ptr_(nullptr),
-      type_id_(kTypeIdNull) {}
+      type_(kTypeNull) {}
 
     Object(const Object &obj) :
       real_dest_(obj.real_dest_),
       mode_(obj.mode_),
       do_not_copy_(obj.do_not_copy_),
+      tag_(obj.tag_),
+      scalar_(obj.scalar_),
       ref_count_(0),
       ptr_(obj.ptr_),
-      type_id_(obj.type_id_) {
+      type_(obj.type_) {
       if (obj.mode_ == kObjectRef) {
         real_dest_->ref_count_ += 1;
       }
@@ -105,43 +149,110 @@ namespace kagami {
     Object(const Object &&obj) :
       Object(obj) {}
 
+    //Reference (and its counter) goes with the content, source becomes null
+    Object(Object &&obj) noexcept :
+      Object() {
+      swap(obj);
+    }
+
     template <class T>
-    Object(shared_ptr<T> ptr, string type_id) :
+    Object(shared_ptr<T> ptr, TypeId type) :
       real_dest_(nullptr),
       mode_(kObjectNormal),
       do_not_copy_(false),
+      tag_(kScalarNull),
+      scalar_(),
       ref_count_(0),
       ptr_(ptr), 
-      type_id_(type_id) {}
+      type_(type) {}
 
     template <class T>
-    Object(T &t, string type_id) :
+    Object(shared_ptr<T> ptr, string type_id) :
+      Object(ptr, InternTypeId(type_id)) {}
+
+    template <class T>
+    Object(T &t, TypeId type) :
       real_dest_(nullptr),
       mode_(kObjectNormal),
       do_not_copy_(false),
+      tag_(kScalarNull),
+      scalar_(),
       ref_count_(0),
-      ptr_(make_shared<T>(t)),
-      type_id_(type_id) {}
+      ptr_(MakePooled<T>(t)),
+      type_(type) {}
+
+    template <class T>
+    Object(T &t, string type_id) :
+      Object(t, InternTypeId(type_id)) {}
+
+    template <class T>
+    Object(T &&t, TypeId type) :
+      Object(t, type) {}
 
     template <class T>
     Object(T &&t, string type_id) :
-      Object(t, type_id) {}
+      Object(t, InternTypeId(type_id)) {}
+
+    Object(int64_t value, TypeId type) :
+      real_dest_(nullptr),
+      mode_(kObjectNormal),
+      do_not_copy_(false),
+      tag_(kScalarInt),
+      scalar_(),
+      ref_count_(0),
+      ptr_(nullptr),
+      type_(type) { scalar_.int_value = value; }
+
+    Object(double value, TypeId type) :
+      real_dest_(nullptr),
+      mode_(kObjectNormal),
+      do_not_copy_(false),
+      tag_(kScalarFloat),
+      scalar_(),
+      ref_count_(0),
+      ptr_(nullptr),
+      type_(type) { scalar_.float_value = value; }
+
+    Object(bool value, TypeId type) :
+      real_dest_(nullptr),
+      mode_(kObjectNormal),
+      do_not_copy_(false),
+      tag_(kScalarBool),
+      scalar_(),
+      ref_count_(0),
+      ptr_(nullptr),
+      type_(type) { scalar_.bool_value = value; }
+
+    Object(int64_t value, string type_id) :
+      Object(value, InternTypeId(type_id)) {}
+
+    Object(double value, string type_id) :
+      Object(value, InternTypeId(type_id)) {}
+
+    Object(bool value, string type_id) :
+      Object(value, InternTypeId(type_id)) {}
 
     Object(string str) :
       real_dest_(nullptr),
       mode_(kObjectNormal),
       do_not_copy_(false),
+      tag_(kScalarNull),
+      scalar_(),
       ref_count_(0),
-      ptr_(std::make_shared<string>(str)),
-      type_id_(kTypeIdString) {}
+      ptr_(MakePooled<string>(str)),
+      type_(kTypeString) {}
 
     Object &operator=(const Object &object);
-    Object &PackContent(shared_ptr<void> ptr, string type_id);
+    Object &PackContent(shared_ptr<void> ptr, TypeId type);
+    Object &PackContent(shared_ptr<void> ptr, string type_id) {
+      return PackContent(ptr, InternTypeId(type_id));
+    }
     Object &swap(Object &obj);
     Object &PackObject(Object &object);
 
     shared_ptr<void> Get() {
       if (mode_ == kObjectRef) return real_dest_->Get();
+      if (tag_ != kScalarNull) return BoxScalar();
       return ptr_;
     }
 
@@ -159,9 +270,18 @@ namespace kagami {
         return real_dest_->Cast<Tx>(); 
       }
 
+      if (auto *value = GetScalar<Tx>(); value != nullptr) {
+        return *value;
+      }
+
       return *std::static_pointer_cast<Tx>(ptr_);
     }
 
+    template <class Tx>
+    const Tx &Cast() const {
+      return const_cast<Object *>(this)->Cast<Tx>();
+    }
+
     Object &SetDeliverFlag() {
       do_not_copy_ = true;
       return *this;
@@ -197,71 +317,180 @@ namespace kagami {
 
     Object &swap(Object &&obj) { return swap(obj); }
 
-    string GetTypeId() const { return type_id_; }
+    const string &GetTypeId() const { return GetTypeName(type_); }
+
+    TypeId GetType() const { return type_; }
 
     int64_t ObjRefCount() const { return ref_count_; }
 
     bool IsRef() const { return mode_ == kObjectRef; }
 
-    bool Null() const { return ptr_ == nullptr && real_dest_ == nullptr; }
+    ScalarTag GetScalarTag() const {
+      if (mode_ == kObjectRef) return real_dest_->GetScalarTag();
+      return tag_;
+    }
+
+    bool IsScalar() const { return GetScalarTag() != kScalarNull; }
+
+    size_t GetScalarHash() const;
+    bool CompareScalar(const Object &obj) const;
+
+    bool Null() const { 
+      return ptr_ == nullptr && real_dest_ == nullptr && tag_ == kScalarNull; 
+    }
   };
 
-  using ObjectArray = deque<Object>;
+  /*
+    Copy-on-write payload of containers.
+    Copying the payload only shares its buffer. Readers use Read(), and every
+    writer must use Write(), which clones the buffer by CloneBuffer() while it
+    is still shared with other payloads.
+    Anyone who hands out references or iterators into the buffer must use
+    Leak() instead. Those references may be written later without going
+    through this payload, so a leaked buffer is never shared again and every
+    copy of it gets its own clone.
+  */
+  template <class Buffer>
+  class CopyOnWrite {
+  private:
+    shared_ptr<Buffer> buffer_;
+    bool leaked_;
+
+  public:
+    CopyOnWrite() : buffer_(MakePooled<Buffer>()), leaked_(false) {}
+
+    CopyOnWrite(const CopyOnWrite &rhs) :
+      buffer_(rhs.leaked_ ? CloneBuffer(*rhs.buffer_) : rhs.buffer_),
+      leaked_(false) {}
+
+    CopyOnWrite &operator=(const CopyOnWrite &rhs) {
+      if (this == &rhs) return *this;
+      buffer_ = rhs.leaked_ ? CloneBuffer(*rhs.buffer_) : rhs.buffer_;
+      leaked_ = false;
+      return *this;
+    }
+
+    Buffer &Read() { return *buffer_; }
+
+    const Buffer &Read() const { return *buffer_; }
+
+    Buffer &Write() {
+      if (buffer_.use_count() > 1) buffer_ = CloneBuffer(*buffer_);
+      return *buffer_;
+    }
+
+    Buffer &Leak() {
+      auto &buffer = Write();
+      leaked_ = true;
+      return buffer;
+    }
+
+    bool Shared() const { return buffer_.use_count() > 1; }
+  };
+
+  using ArrayBuffer = deque<Object>;
+  using ObjectArray = CopyOnWrite<ArrayBuffer>;
   using ManagedArray = shared_ptr<ObjectArray>;
+
+  shared_ptr<ArrayBuffer> CloneBuffer(const ArrayBuffer &src);
   using ObjectPair = pair<Object, Object>;
   using ManagedPair = shared_ptr<ObjectPair>;
 
+  //Entries of scope stored in one chunk
+  const size_t kScopeChunkSize = 8;
+  //Scope with more entries than this is looked up by hash index
+  const size_t kScopeLinearLimit = 8;
+
+  /*
+    Storage of one scope.
+    Entries are placed in fixed-size chunks in order of insertion, so address
+    of object never moves until scope is cleared, and chunks are kept for
+    next use of scope. Small scope is searched linearly, larger one builds an
+    open-addressing index lazily. Disposed entry stays as a hole with empty
+    identifier until next clearing.
+  */
   class ObjectContainer {
   private:
-    ObjectContainer *prev_;
-    map<string, Object> base_;
-    unordered_map<string, Object *>dest_map_;
+    struct Chunk {
+      alignas(NamedObject) char data[sizeof(NamedObject) * kScopeChunkSize];
+    };
 
-    bool CheckObject(string id) {
-      return (base_.find(id) != base_.end());
+    ObjectContainer *prev_;
+    vector<unique_ptr<Chunk>> chunks_;
+    vector<uint32_t> index_;
+    size_t size_;
+    size_t live_;
+    bool indexed_;
+
+    NamedObject &At(size_t idx) const {
+      return reinterpret_cast<NamedObject *>(
+        chunks_[idx / kScopeChunkSize]->data)[idx % kScopeChunkSize];
     }
 
-    void BuildCache();
+    NamedObject *Lookup(const string &id) const;
+    void IndexEntry(size_t idx);
+    void BuildIndex();
+    void CopyFrom(const ObjectContainer &container);
+
   public:
+    class iterator {
+    private:
+      const ObjectContainer *base_;
+      size_t idx_;
+
+      void SkipHoles() {
+        while (idx_ < base_->size_ && base_->At(idx_).first.empty()) ++idx_;
+      }
+
+    public:
+      iterator(const ObjectContainer *base, size_t idx) :
+        base_(base), idx_(idx) { SkipHoles(); }
+
+      NamedObject &operator*() const { return base_->At(idx_); }
+      NamedObject *operator->() const { return &base_->At(idx_); }
+      iterator &operator++() { ++idx_; SkipHoles(); return *this; }
+      bool operator==(const iterator &rhs) const { return idx_ == rhs.idx_; }
+      bool operator!=(const iterator &rhs) const { return idx_ != rhs.idx_; }
+    };
+
     bool Add(string id, Object source);
     bool Dispose(string id);
-    Object *Find(string id, bool forward_seeking = true);
+    Object *Find(const string &id, bool forward_seeking = true);
     bool FindDest(Object *ptr);
-    string FindDomain(string id, bool forward_seeking = true);
-    void ClearExcept(string exceptions);
+    string FindDomain(const string &id, bool forward_seeking = true);
+    void ClearExcept(const string &exceptions);
+    void Clear();
 
-    ObjectContainer() : prev_(nullptr), base_(), dest_map_() {}
+    ObjectContainer() : prev_(nullptr), chunks_(), index_(), 
+      size_(0), live_(0), indexed_(false) {}
 
-    ObjectContainer(const ObjectContainer &&mgr) {}
+    ObjectContainer(const ObjectContainer &&mgr) : ObjectContainer() {}
 
-    ObjectContainer(const ObjectContainer &container) :
-      prev_(container.prev_) {
-      if (!container.base_.empty()) {
-        base_ = container.base_;
-        BuildCache();
-      }
+    ObjectContainer(const ObjectContainer &container) : ObjectContainer() {
+      prev_ = container.prev_;
+      CopyFrom(container);
     }
 
+    ~ObjectContainer() { Clear(); }
+
     bool Empty() const {
-      return base_.empty();
+      return live_ == 0;
     }
 
     ObjectContainer &operator=(ObjectContainer &mgr) {
-      base_ = mgr.base_;
+      if (&mgr != this) {
+        Clear();
+        CopyFrom(mgr);
+      }
+
       return *this;
     }
 
-    void Clear() {
-      base_.clear();
-      BuildCache();
-    }
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, size_); }
 
-    auto &GetContent() {
-      return base_;
-    }
-
-    auto &GetHashMap() {
-      return dest_map_;
+    ObjectContainer &GetContent() {
+      return *this;
     }
 
     ObjectContainer &SetPreviousContainer(ObjectContainer *prev) {
@@ -312,8 +541,8 @@ namespace kagami {
       return this->operator[](id).Cast<T>();
     }
 
-    bool CheckTypeId(string id, string type_id) {
-      return this->at(id).GetTypeId() == type_id;
+    bool CheckTypeId(string id, TypeId type) {
+      return this->at(id).GetType() == type;
     }
 
     bool CheckTypeId(string id, ComparingFunction func) {
@@ -333,15 +562,18 @@ namespace kagami {
   private:
     using DataType = list<ObjectContainer>;
     DataType base_;
+    DataType spare_;
     ObjectStack *prev_;
 
   public:
     ObjectStack() :
       base_(),
+      spare_(),
       prev_(nullptr) {}
 
     ObjectStack(const ObjectStack &rhs) :
       base_(rhs.base_),
+      spare_(),
       prev_(rhs.prev_) {}
 
     ObjectStack(const ObjectStack &&rhs) :
@@ -360,21 +592,27 @@ namespace kagami {
       return true;
     }
 
-    bool ClearCurrentExcept(string exceptions) {
+    bool ClearCurrentExcept(const string &exceptions) {
       if (base_.empty()) return false;
       base_.back().ClearExcept(exceptions);
       return true;
     }
 
+    //Popped scopes are parked in spare list with their chunks, and pushing
+    //takes them back without allocation.
     ObjectStack &Push() {
       auto *prev = base_.empty() ? nullptr : &base_.back();
-      base_.emplace_back(ObjectContainer());
+
+      if (spare_.empty()) base_.emplace_back(ObjectContainer());
+      else base_.splice(base_.end(), spare_, spare_.begin());
+
       base_.back().SetPreviousContainer(prev);
       return *this;
     }
 
     ObjectStack &Pop() {
-      base_.pop_back();
+      base_.back().Clear();
+      spare_.splice(spare_.begin(), base_, std::prev(base_.end()));
       return *this;
     }
 
@@ -383,7 +621,7 @@ namespace kagami {
     }
 
     void MergeMap(ObjectMap &p);
-    Object *Find(string id);
+    Object *Find(const string &id);
     bool CreateObject(string id, Object obj);
     bool DisposeObjectInCurrentScope(string id);
   };
@@ -0,0 +1,195 @@
+#include "pool.h"
+#include <algorithm>
+
+namespace kagami {
+  static_assert(2 * sizeof(void *) <= kPoolGranularity,
+    "Slab header must fit in one granule");
+
+  SizeClassPool::~SizeClassPool() {
+    while (slab_list_ != nullptr) {
+      auto *next = slab_list_->next;
+      ::operator delete(slab_list_, std::align_val_t(kPoolSlabSize));
+      slab_list_ = next;
+    }
+  }
+
+  //Blocks released by other threads are moved to free lists of this pool.
+  void SizeClassPool::TakeRemote() {
+    auto *node = remote_.exchange(nullptr, std::memory_order_acquire);
+
+    while (node != nullptr) {
+      auto *next = node->next;
+      PushLocal(node, node->class_idx);
+      node = next;
+    }
+  }
+
+  //Free list of size class is empty. Blocks released by other threads are
+  //taken back at first, and then a batch of blocks is cut from slab.
+  void *SizeClassPool::Refill(size_t class_idx) {
+    const size_t block_size = (class_idx + 1) * kPoolGranularity;
+    const size_t batch = kPoolSlabSize / kPoolMaxBlockSize;
+
+    TakeRemote();
+
+    if (auto *node = free_[class_idx]; node != nullptr) {
+      free_[class_idx] = node->next;
+      return node;
+    }
+
+    if (cursor_ == nullptr || static_cast<size_t>(end_ - cursor_) < block_size) {
+      auto *slab = static_cast<char *>(
+        ::operator new(kPoolSlabSize, std::align_val_t(kPoolSlabSize)));
+      auto *header = reinterpret_cast<SlabHeader *>(slab);
+      header->owner = this;
+      header->next = slab_list_;
+      slab_list_ = header;
+      cursor_ = slab + kPoolGranularity;
+      end_ = slab + kPoolSlabSize;
+      slabs_.Add(1);
+    }
+
+    void *result = cursor_;
+    cursor_ += block_size;
+
+    for (size_t count = 1; count < batch; ++count) {
+      if (static_cast<size_t>(end_ - cursor_) < block_size) break;
+
+      auto *node = reinterpret_cast<FreeNode *>(cursor_);
+      node->next = free_[class_idx];
+      free_[class_idx] = node;
+      cursor_ += block_size;
+    }
+
+    return result;
+  }
+
+  void SizeClassPool::AddStats(AllocatorStats &dest) const {
+    dest.allocations += allocations_.Get();
+    dest.deallocations += deallocations_.Get();
+    dest.bytes_allocated += bytes_allocated_.Get();
+    dest.bytes_in_use += bytes_in_use_.Get();
+    dest.large_allocations += large_allocations_.Get();
+    dest.slabs += slabs_.Get();
+  }
+
+  /*
+    Registry of pools.
+    Pool of exited thread is deleted if all of its blocks are back, and its
+    counters are kept in retired stats. Otherwise it's parked, and the next
+    new thread adopts it instead of creating another one.
+  */
+  struct PoolRegistry {
+    std::mutex lock;
+    vector<SizeClassPool *> pools;
+    vector<SizeClassPool *> parked;
+    AllocatorStats retired;
+    std::atomic<uint64_t> late_deallocations;
+    std::atomic<uint64_t> late_bytes_released;
+  };
+
+  //Never destroyed, because objects in static storage may be released after
+  //everything else is gone.
+  PoolRegistry &GetPoolRegistry() {
+    static PoolRegistry *registry = new PoolRegistry{
+      {}, {}, {}, AllocatorStats{ 0, 0, 0, 0, 0, 0 }, {0}, {0}
+    };
+    return *registry;
+  }
+
+  thread_local SizeClassPool *current_pool = nullptr;
+
+  SizeClassPool *AcquirePool() {
+    auto &registry = GetPoolRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+
+    if (!registry.parked.empty()) {
+      auto *pool = registry.parked.back();
+      registry.parked.pop_back();
+      return pool;
+    }
+
+    auto *pool = new SizeClassPool();
+    registry.pools.push_back(pool);
+    return pool;
+  }
+
+  void RetirePool(SizeClassPool *pool) {
+    auto &registry = GetPoolRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+
+    pool->TakeRemote();
+
+    if (pool->GetLiveBlocks() != 0) {
+      registry.parked.push_back(pool);
+      return;
+    }
+
+    auto &pools = registry.pools;
+    pools.erase(std::find(pools.begin(), pools.end(), pool));
+    pool->AddStats(registry.retired);
+    delete pool;
+  }
+
+  //Gives pool of thread back to registry when the thread exits
+  struct PoolGuard {
+    ~PoolGuard() {
+      if (current_pool == nullptr) return;
+      RetirePool(current_pool);
+      current_pool = nullptr;
+    }
+  };
+
+  SizeClassPool &GetObjectPool() {
+    if (current_pool == nullptr) {
+      //Pool which is created after guard is destroyed is never retired.
+      thread_local PoolGuard guard;
+      current_pool = AcquirePool();
+    }
+
+    return *current_pool;
+  }
+
+  void ReleasePoolBlock(void *ptr, size_t size) {
+    auto *pool = current_pool;
+
+    if (pool != nullptr) {
+      pool->CountRelease(size);
+    }
+    else {
+      auto &registry = GetPoolRegistry();
+      registry.late_deallocations.fetch_add(1, std::memory_order_relaxed);
+      registry.late_bytes_released.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    if (size > kPoolMaxBlockSize || size == 0) {
+      ::operator delete(ptr);
+      return;
+    }
+
+    size_t class_idx = (size - 1) / kPoolGranularity;
+    auto *owner = SizeClassPool::GetOwner(ptr);
+
+    if (owner == pool) {
+      owner->PushLocal(ptr, class_idx);
+    }
+    else {
+      owner->PushRemote(ptr, class_idx);
+    }
+  }
+
+  AllocatorStats GetAllocatorStats() {
+    auto &registry = GetPoolRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    AllocatorStats result = registry.retired;
+
+    for (auto *unit : registry.pools) unit->AddStats(result);
+
+    result.deallocations +=
+      registry.late_deallocations.load(std::memory_order_relaxed);
+    result.bytes_in_use -=
+      registry.late_bytes_released.load(std::memory_order_relaxed);
+
+    return result;
+  }
+}
@@ -0,0 +1,208 @@
+#pragma once
+#include "common.h"
+
+namespace kagami {
+  const size_t kPoolGranularity = 16;
+  const size_t kPoolMaxBlockSize = 256;
+  const size_t kPoolSlabSize = 64 * 1024;
+  const size_t kPoolClassCount = kPoolMaxBlockSize / kPoolGranularity;
+
+  struct AllocatorStats {
+    uint64_t allocations;
+    uint64_t deallocations;
+    uint64_t bytes_allocated;
+    uint64_t bytes_in_use;
+    uint64_t large_allocations;
+    uint64_t slabs;
+  };
+
+  //Counter is written by thread which owns the pool only, but it may be
+  //read by other threads while summing statistics.
+  class PoolCounter {
+  private:
+    std::atomic<uint64_t> value_;
+
+  public:
+    PoolCounter() : value_(0) {}
+
+    void Add(uint64_t value) {
+      value_.store(value_.load(std::memory_order_relaxed) + value,
+        std::memory_order_relaxed);
+    }
+
+    uint64_t Get() const { return value_.load(std::memory_order_relaxed); }
+  };
+
+  /*
+    Size-class allocator for payload of objects.
+    Small blocks are carved from slabs and recycled by free list of their
+    size class. Blocks larger than kPoolMaxBlockSize go to general heap.
+    Every thread has a pool of its own. Slabs are aligned to their size and
+    start with a header which points to the pool, so a block always goes
+    back to the pool it was carved from. Block released on another thread
+    is pushed to remote list of that pool, and the pool takes the whole
+    list back when a free list runs out.
+    Counters belong to the thread doing the work, so counters of one pool
+    are not net values. Only the sum of all pools is.
+  */
+  class SizeClassPool {
+  private:
+    struct FreeNode {
+      FreeNode *next;
+    };
+
+    struct RemoteNode {
+      RemoteNode *next;
+      size_t class_idx;
+    };
+
+    //Occupies the first granule of every slab
+    struct SlabHeader {
+      SizeClassPool *owner;
+      SlabHeader *next;
+    };
+
+    array<FreeNode *, kPoolClassCount> free_;
+    std::atomic<RemoteNode *> remote_;
+    SlabHeader *slab_list_;
+    char *cursor_;
+    char *end_;
+    size_t live_;
+    PoolCounter allocations_;
+    PoolCounter deallocations_;
+    PoolCounter bytes_allocated_;
+    PoolCounter bytes_in_use_;
+    PoolCounter large_allocations_;
+    PoolCounter slabs_;
+
+    void *Refill(size_t class_idx);
+
+  public:
+    SizeClassPool() :
+      free_(),
+      remote_(nullptr),
+      slab_list_(nullptr),
+      cursor_(nullptr),
+      end_(nullptr),
+      live_(0),
+      allocations_(),
+      deallocations_(),
+      bytes_allocated_(),
+      bytes_in_use_(),
+      large_allocations_(),
+      slabs_() {}
+
+    ~SizeClassPool();
+
+    SizeClassPool(const SizeClassPool &) = delete;
+    SizeClassPool &operator=(const SizeClassPool &) = delete;
+
+    static SizeClassPool *GetOwner(void *ptr) {
+      auto addr = reinterpret_cast<uintptr_t>(ptr) & ~(kPoolSlabSize - 1);
+      return reinterpret_cast<SlabHeader *>(addr)->owner;
+    }
+
+    void *Allocate(size_t size) {
+      allocations_.Add(1);
+      bytes_allocated_.Add(size);
+      bytes_in_use_.Add(size);
+
+      if (size > kPoolMaxBlockSize || size == 0) {
+        large_allocations_.Add(1);
+        return ::operator new(size);
+      }
+
+      size_t class_idx = (size - 1) / kPoolGranularity;
+      FreeNode *node = free_[class_idx];
+
+      live_ += 1;
+
+      if (node == nullptr) return Refill(class_idx);
+
+      free_[class_idx] = node->next;
+      return node;
+    }
+
+    //Only called by thread which owns the pool
+    void CountRelease(size_t size) {
+      deallocations_.Add(1);
+      //Wraps around if block came from another thread, sum is still right
+      bytes_in_use_.Add(0 - static_cast<uint64_t>(size));
+    }
+
+    //Block carved from this pool, released by thread which owns the pool
+    void PushLocal(void *ptr, size_t class_idx) {
+      auto *node = static_cast<FreeNode *>(ptr);
+      node->next = free_[class_idx];
+      free_[class_idx] = node;
+      live_ -= 1;
+    }
+
+    //Block carved from this pool, released by any other thread
+    void PushRemote(void *ptr, size_t class_idx) {
+      auto *node = static_cast<RemoteNode *>(ptr);
+      node->class_idx = class_idx;
+      node->next = remote_.load(std::memory_order_relaxed);
+
+      while (!remote_.compare_exchange_weak(node->next, node,
+        std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void TakeRemote();
+
+    //Blocks which are handed out and not back in free lists yet
+    size_t GetLiveBlocks() const { return live_; }
+
+    void AddStats(AllocatorStats &dest) const;
+  };
+
+  //Pool of current thread, it's created at first use
+  SizeClassPool &GetObjectPool();
+
+  //Return a block to the pool it came from
+  void ReleasePoolBlock(void *ptr, size_t size);
+
+  //Sum of pools of all threads
+  AllocatorStats GetAllocatorStats();
+
+  template <class T>
+  class PoolAllocator {
+  public:
+    using value_type = T;
+
+    PoolAllocator() noexcept {}
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+    T *allocate(size_t n) {
+      if constexpr (alignof(T) > kPoolGranularity) {
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+      }
+      else {
+        return static_cast<T *>(GetObjectPool().Allocate(n * sizeof(T)));
+      }
+    }
+
+    void deallocate(T *ptr, size_t n) noexcept {
+      if constexpr (alignof(T) > kPoolGranularity) {
+        ::operator delete(ptr);
+      }
+      else {
+        ReleasePoolBlock(ptr, n * sizeof(T));
+      }
+    }
+
+    template <class U>
+    bool operator==(const PoolAllocator<U> &) const noexcept { return true; }
+
+    template <class U>
+    bool operator!=(const PoolAllocator<U> &) const noexcept { return false; }
+  };
+
+  //make_shared() replacement, control block and value share one pooled block.
+  template <class T, class... Args>
+  shared_ptr<T> MakePooled(Args &&... args) {
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+  }
+}
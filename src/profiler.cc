@@ -0,0 +1,116 @@
+#include <algorithm>
+#include "profiler.h"
+
+namespace kagami {
+  void Profiler::Charge(Clock::time_point now) {
+    uint64_t elapsed = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count());
+    last_ = now;
+
+    if (last_line_ != nullptr) last_line_->time += elapsed;
+
+    if (!frames_.empty()) {
+      frames_.back().func->exclusive += elapsed;
+      *frames_.back().folded += elapsed;
+    }
+  }
+
+  void Profiler::Tick(size_t line) {
+    Charge(Clock::now());
+    last_line_ = &lines_[line];
+    last_line_->count += 1;
+    count_ += 1;
+
+    if (!frames_.empty()) frames_.back().func->count += 1;
+  }
+
+  void Profiler::Enter(const string &id) {
+    auto now = Clock::now();
+    Charge(now);
+
+    string stack = frames_.empty() ? id : frames_.back().stack + ";" + id;
+    auto &func = functions_[id];
+    func.calls += 1;
+    func.active += 1;
+
+    frames_.push_back(ProfilerFrame{ &func, &folded_[stack], stack, now });
+  }
+
+  void Profiler::Exit() {
+    if (frames_.empty()) return;
+
+    auto now = Clock::now();
+    Charge(now);
+
+    auto &frame = frames_.back();
+    frame.func->active -= 1;
+
+    if (frame.func->active == 0) {
+      frame.func->inclusive += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - frame.enter).count());
+    }
+
+    frames_.pop_back();
+  }
+
+  bool Profiler::Report(string path) {
+    //Frames may be left open by runtime error
+    while (!frames_.empty()) Exit();
+    Charge(Clock::now());
+
+    auto to_ms = [](uint64_t ns) -> double { return static_cast<double>(ns) / 1e6; };
+    uint64_t total = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(last_ - begin_).count());
+
+    FILE *fp = fopen(path.data(), "w");
+    if (fp == nullptr) return false;
+
+    vector<pair<string, FunctionProfile>> functions(functions_.begin(), functions_.end());
+    vector<pair<size_t, LineProfile>> lines(lines_.begin(), lines_.end());
+
+    std::stable_sort(functions.begin(), functions.end(),
+      [](auto &lhs, auto &rhs) { return lhs.second.exclusive > rhs.second.exclusive; });
+    std::sort(lines.begin(), lines.end(), [](auto &lhs, auto &rhs) {
+      return lhs.second.time != rhs.second.time ?
+        lhs.second.time > rhs.second.time : lhs.first < rhs.first;
+    });
+
+    fprintf(fp, "Total time: %.3f ms\n", to_ms(total));
+    fprintf(fp, "Total instructions: %llu\n\n",
+      static_cast<unsigned long long>(count_));
+
+    fprintf(fp, "%-24s %10s %14s %14s %14s\n",
+      "Function", "Calls", "Instructions", "Inclusive(ms)", "Exclusive(ms)");
+    for (auto &unit : functions) {
+      fprintf(fp, "%-24s %10llu %14llu %14.3f %14.3f\n",
+        unit.first.data(),
+        static_cast<unsigned long long>(unit.second.calls),
+        static_cast<unsigned long long>(unit.second.count),
+        to_ms(unit.second.inclusive),
+        to_ms(unit.second.exclusive));
+    }
+
+    fprintf(fp, "\n%-8s %14s %14s\n", "Line", "Instructions", "Time(ms)");
+    for (auto &unit : lines) {
+      fprintf(fp, "%-8zu %14llu %14.3f\n",
+        unit.first,
+        static_cast<unsigned long long>(unit.second.count),
+        to_ms(unit.second.time));
+    }
+
+    fclose(fp);
+
+    //Folded stacks in microseconds, one stack per line.
+    fp = fopen((path + ".folded").data(), "w");
+    if (fp == nullptr) return false;
+
+    for (auto &unit : folded_) {
+      uint64_t us = unit.second / 1000;
+      if (us == 0) continue;
+      fprintf(fp, "%s %llu\n", unit.first.data(), static_cast<unsigned long long>(us));
+    }
+
+    fclose(fp);
+    return true;
+  }
+}
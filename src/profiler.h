@@ -0,0 +1,64 @@
+#pragma once
+#include <chrono>
+#include "common.h"
+
+namespace kagami {
+  struct LineProfile {
+    uint64_t count;
+    uint64_t time;
+  };
+
+  struct FunctionProfile {
+    uint64_t calls;
+    uint64_t count;
+    uint64_t inclusive;
+    uint64_t exclusive;
+    size_t active;
+  };
+
+  /*
+    Deterministic profiler of machine.
+    Time between two ticks is charged to the line of last instruction and to
+    the function on top of call stack. Inclusive time is only measured at the
+    outermost activation of a function, so recursive calls are not counted
+    twice. All of time values are in nanoseconds.
+  */
+  class Profiler {
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct ProfilerFrame {
+      FunctionProfile *func;
+      uint64_t *folded;
+      string stack;
+      Clock::time_point enter;
+    };
+
+    unordered_map<size_t, LineProfile> lines_;
+    map<string, FunctionProfile> functions_;
+    map<string, uint64_t> folded_;
+    vector<ProfilerFrame> frames_;
+    LineProfile *last_line_;
+    Clock::time_point begin_;
+    Clock::time_point last_;
+    uint64_t count_;
+
+    void Charge(Clock::time_point now);
+
+  public:
+    Profiler() :
+      lines_(),
+      functions_(),
+      folded_(),
+      frames_(),
+      last_line_(nullptr),
+      begin_(Clock::now()),
+      last_(begin_),
+      count_(0) {}
+
+    void Tick(size_t line);
+    void Enter(const string &id);
+    void Exit();
+    bool Report(string path);
+  };
+}
@@ -3,7 +3,7 @@
 namespace kagami {
 #if not defined(_DISABLE_SDL_)
   Message NewMusicObject(ObjectMap &p) {
-    EXPECT_TYPE(p, "path", kTypeIdString);
+    EXPECT_TYPE(p, "path", kTypeString);
     string path = p.Cast<string>("path");
     dawn::ManagedMusic music(new dawn::Music(path));
 
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include "stats.h"
+#include "util.h"
+#include "pool.h"
+
+namespace kagami {
+  std::mutex &GetRuntimeStatsLock() {
+    static std::mutex lock;
+    return lock;
+  }
+
+  RuntimeStats &GetRuntimeStatsTotal() {
+    static RuntimeStats stats{};
+    return stats;
+  }
+
+  auto &GetAttachedStats() {
+    thread_local vector<RuntimeStats *> attached;
+    return attached;
+  }
+
+  void AddRuntimeStats(RuntimeStats &dest, const RuntimeStats &src) {
+    for (size_t idx = 0; idx < dest.commands.size(); ++idx) {
+      dest.commands[idx] += src.commands[idx];
+    }
+
+    dest.calls += src.calls;
+    dest.lookups += src.lookups;
+    dest.scope_walks += src.scope_walks;
+    dest.object_copies += src.object_copies;
+    dest.frames_pushed += src.frames_pushed;
+    dest.frames_reused += src.frames_reused;
+    if (src.peak_depth > dest.peak_depth) dest.peak_depth = src.peak_depth;
+  }
+
+  void AttachRuntimeStats(RuntimeStats *stats) {
+    GetAttachedStats().push_back(stats);
+  }
+
+  void DetachRuntimeStats(RuntimeStats *stats) {
+    auto &attached = GetAttachedStats();
+    auto it = std::find(attached.begin(), attached.end(), stats);
+
+    if (it == attached.end()) return;
+
+    attached.erase(it);
+    std::lock_guard<std::mutex> guard(GetRuntimeStatsLock());
+    AddRuntimeStats(GetRuntimeStatsTotal(), *stats);
+  }
+
+  RuntimeStats *GetActiveRuntimeStats() {
+    auto &attached = GetAttachedStats();
+    return attached.empty() ? nullptr : attached.back();
+  }
+
+  RuntimeStats GetRuntimeStats() {
+    RuntimeStats result{};
+
+    {
+      std::lock_guard<std::mutex> guard(GetRuntimeStatsLock());
+      result = GetRuntimeStatsTotal();
+    }
+
+    for (auto *unit : GetAttachedStats()) AddRuntimeStats(result, *unit);
+
+    return result;
+  }
+
+  string GetKeywordName(Keyword token) {
+    switch (token) {
+    case kKeywordExpList:      return "!exp_list";
+    case kKeywordBind:         return "=";
+    case kKeywordDeliver:      return "<-";
+    case kKeywordInitialArray: return "!init_array";
+    case kKeywordExist:        return kStrExist;
+    case kKeywordQuit:         return "quit";
+    case kKeywordNull:         return "!null";
+    default:break;
+    }
+
+    for (auto &unit : util::GetKeywordBase()) {
+      if (unit.second == token) return unit.first;
+    }
+
+    return "!unknown";
+  }
+
+  //Flatten counters into name/value pairs.
+  //Commands which are never executed are left out.
+  vector<pair<string, uint64_t>> CollectRuntimeStats() {
+    auto stats = GetRuntimeStats();
+    vector<pair<string, uint64_t>> result;
+    uint64_t commands = 0;
+
+    for (size_t idx = 0; idx < stats.commands.size(); ++idx) {
+      commands += stats.commands[idx];
+    }
+
+    result.emplace_back("commands", commands);
+    result.emplace_back("calls", stats.calls);
+    result.emplace_back("lookups", stats.lookups);
+    result.emplace_back("scope_walks", stats.scope_walks);
+    result.emplace_back("object_copies", stats.object_copies);
+    result.emplace_back("frames_pushed", stats.frames_pushed);
+    result.emplace_back("frames_reused", stats.frames_reused);
+    result.emplace_back("peak_depth", stats.peak_depth);
+
+    auto alloc = GetAllocatorStats();
+    result.emplace_back("allocations", alloc.allocations);
+    result.emplace_back("deallocations", alloc.deallocations);
+    result.emplace_back("allocated_bytes", alloc.bytes_allocated);
+    result.emplace_back("bytes_in_use", alloc.bytes_in_use);
+    result.emplace_back("large_allocations", alloc.large_allocations);
+    result.emplace_back("slabs", alloc.slabs);
+
+    for (size_t idx = 0; idx < stats.commands.size(); ++idx) {
+      if (stats.commands[idx] == 0) continue;
+      result.emplace_back(
+        "command:" + GetKeywordName(static_cast<Keyword>(idx)),
+        stats.commands[idx]);
+    }
+
+    return result;
+  }
+}
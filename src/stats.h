@@ -0,0 +1,42 @@
+#pragma once
+#include "common.h"
+
+namespace kagami {
+  /*
+    Counters of runtime behavior.
+    Every machine counts commands, calls and frames of its own, only if it's
+    asked to (stats option). Object layer counts lookups, scope levels walked
+    and deep copies into the machine running on current thread, only in
+    builds with _OBJECT_STATS_. Counters of a machine are merged into the
+    process totals when it's finished.
+  */
+  struct RuntimeStats {
+    array<uint64_t, kKeywordNull + 1> commands;
+    uint64_t calls;
+    uint64_t lookups;
+    uint64_t scope_walks;
+    uint64_t object_copies;
+    uint64_t frames_pushed;
+    uint64_t frames_reused;
+    uint64_t peak_depth;
+  };
+
+  //Counters of machine are visible to GetRuntimeStats() while attached
+  void AttachRuntimeStats(RuntimeStats *stats);
+  void DetachRuntimeStats(RuntimeStats *stats);
+  RuntimeStats *GetActiveRuntimeStats();
+
+  //Process totals and counters of machines running on current thread
+  RuntimeStats GetRuntimeStats();
+  string GetKeywordName(Keyword token);
+  vector<pair<string, uint64_t>> CollectRuntimeStats();
+}
+
+#if defined(_OBJECT_STATS_)
+#define OBJECT_STATS_COUNT(_Member)                          \
+  if (auto *active_stats = GetActiveRuntimeStats()) {        \
+    active_stats->_Member += 1;                              \
+  }
+#else
+#define OBJECT_STATS_COUNT(_Member)
+#endif
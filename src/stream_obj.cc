@@ -10,7 +10,7 @@ namespace kagami {
   ///////////////////////////////////////////////////////////////
   // InStream implementations
   Message NewInStream(ObjectMap &p) {
-    EXPECT_TYPE(p, "path", kTypeIdString);
+    EXPECT_TYPE(p, "path", kTypeString);
     string path = p.Cast<string>("path");
 
     shared_ptr<InStream> ifs = make_shared<InStream>(path);
@@ -39,8 +39,8 @@ namespace kagami {
   ///////////////////////////////////////////////////////////////
   // OutStream implementations
   Message NewOutStream(ObjectMap &p) {
-    EXPECT_TYPE(p, "path", kTypeIdString);
-    EXPECT_TYPE(p, "mode", kTypeIdString);
+    EXPECT_TYPE(p, "path", kTypeString);
+    EXPECT_TYPE(p, "mode", kTypeString);
 
     string path = p.Cast<string>("path");
     string mode = p.Cast<string>("mode");
@@ -64,7 +64,7 @@ namespace kagami {
     auto &obj = p["str"];
     bool result = true;
 
-    if (obj.GetTypeId() == kTypeIdString) {
+    if (obj.GetType() == kTypeString) {
       string str = obj.Cast<string>();
       result = ofs.WriteLine(str);
     }
@@ -2,21 +2,21 @@
 
 namespace kagami {
   inline bool IsStringFamily(Object &obj) {
-    return compare(obj.GetTypeId(), kTypeIdString, kTypeIdWideString);
+    return compare(obj.GetType(), kTypeString, kTypeWideString);
   }
 
   Message CreateStringFromArray(ObjectMap &p) {
-    EXPECT_TYPE(p, "src", kTypeIdArray);
-    auto &base = p.Cast<ObjectArray>("src");
-    shared_ptr<string> dest(make_shared<string>());
+    EXPECT_TYPE(p, "src", kTypeArray);
+    auto &base = p.Cast<ObjectArray>("src").Read();
+    shared_ptr<string> dest(MakePooled<string>());
     
     for (auto it = base.begin(); it != base.end(); ++it) {
-      if (it->GetTypeId() == kTypeIdInt) {
+      if (it->GetType() == kTypeInt) {
         dest->append(1, static_cast<char>(it->Cast<int64_t>()));
         continue;
       }
 
-      if (it->GetTypeId() != kTypeIdString) {
+      if (it->GetType() != kTypeString) {
         continue;
       }
 
@@ -27,13 +27,13 @@ namespace kagami {
   }
 
   Message CharFromInt(ObjectMap &p) {
-    EXPECT_TYPE(p, "value", kTypeIdInt);
+    EXPECT_TYPE(p, "value", kTypeInt);
     auto value = static_cast<char>(p.Cast<int64_t>("value"));
     return Message().SetObject(string().append(1, value));
   }
 
   Message IntFromChar(ObjectMap &p) {
-    EXPECT_TYPE(p, "value", kTypeIdString);
+    EXPECT_TYPE(p, "value", kTypeString);
     auto &value = p.Cast<string>("value");
 
     if (value.size() != 1) {
@@ -51,20 +51,20 @@ namespace kagami {
     EXPECT(IsStringFamily(obj),
       "String constructor can't accept this object.");
 
-    if (obj.GetTypeId() == kTypeIdWideString) {
+    if (obj.GetType() == kTypeWideString) {
       wstring wstr = obj.Cast<wstring>();
       string output = ws2s(wstr);
 
-      base.PackContent(make_shared<string>(output), kTypeIdString);
+      base.PackContent(MakePooled<string>(output), kTypeIdString);
     }
-    else if (obj.GetTypeId() == kTypeIdString) {
+    else if (obj.GetType() == kTypeString) {
       string copy = obj.Cast<string>();
-      base.PackContent(make_shared<string>(copy), kTypeIdString);
+      base.PackContent(MakePooled<string>(copy), kTypeIdString);
     }
     else {
       string output = obj.Cast<string>();
 
-      base.PackContent(make_shared<string>(output), kTypeIdString);
+      base.PackContent(MakePooled<string>(output), kTypeIdString);
     }
 
     return Message().SetObject(base);
@@ -74,10 +74,9 @@ namespace kagami {
     auto &rhs = p[kStrRightHandSide];
     string lhs = p[kStrMe].Cast<string>();
 
-    string type_id = rhs.GetTypeId();
     bool result = false;
 
-    if (type_id == kTypeIdString) {
+    if (rhs.GetType() == kTypeString) {
       string rhs_str = rhs.Cast<string>();
       result = (lhs == rhs_str);
     }
@@ -87,10 +86,10 @@ namespace kagami {
 
   Message StringToArray(ObjectMap &p) {
     auto &str = p.Cast<string>(kStrMe);
-    shared_ptr<ObjectArray> base(make_shared<ObjectArray>());
+    shared_ptr<ObjectArray> base(MakePooled<ObjectArray>());
 
     for (auto &unit : str) {
-      base->emplace_back(string().append(1, unit));
+      base->Write().emplace_back(string().append(1, unit));
     }
 
     return Message().SetObject(Object(base, kTypeIdArray));
@@ -98,21 +97,21 @@ namespace kagami {
 
   //wstring
   Message NewWideString(ObjectMap &p) {
-    EXPECT_TYPE(p, "raw_string", kTypeIdString);
+    EXPECT_TYPE(p, "raw_string", kTypeString);
     Object obj = p["raw_string"];
 
     string output = obj.Cast<string>();
     wstring wstr = s2ws(output);
 
     return Message()
-      .SetObject(Object(make_shared<wstring>(wstr), kTypeIdWideString));
+      .SetObject(Object(MakePooled<wstring>(wstr), kTypeIdWideString));
   }
 
   Message WideStringCompare(ObjectMap &p) {
     auto &rhs = p[kStrRightHandSide];
     wstring lhs = p[kStrMe].Cast<wstring>();
     bool result = false;
-    if (rhs.GetTypeId() == kTypeIdWideString) {
+    if (rhs.GetType() == kTypeWideString) {
       wstring rhs_wstr = rhs.Cast<wstring>();
 
       result = (lhs == rhs_wstr);
@@ -129,16 +128,16 @@ namespace kagami {
   }
 
   Message NewRegex(ObjectMap &p) {
-    EXPECT_TYPE(p, "pattern", kTypeIdString);
+    EXPECT_TYPE(p, "pattern", kTypeString);
 
     string pattern_string = p.Cast<string>("pattern");
-    shared_ptr<regex> reg = make_shared<regex>(pattern_string);
+    shared_ptr<regex> reg = MakePooled<regex>(pattern_string);
 
     return Message().SetObject(Object(reg, kTypeIdRegex));
   }
 
   Message RegexMatch(ObjectMap &p) {
-    EXPECT_TYPE(p, "str", kTypeIdString);
+    EXPECT_TYPE(p, "str", kTypeString);
 
     string str = p.Cast<string>("str");
     auto &pat = p.Cast<regex>(kStrMe);
@@ -151,7 +150,7 @@ namespace kagami {
     using management::CreateImpl;
     using namespace management::type;
 
-    ObjectTraitsSetup(kTypeIdString, PlainDeliveryImpl<string>, PlainHasher<string>)
+    ObjectTraitsSetup(kTypeIdString, SharedDelivery, PlainHasher<string>)
       .InitComparator(PlainComparator<string>)
       .InitConstructor(
         FunctionImpl(NewString, "raw_string", "string")
@@ -167,7 +166,7 @@ namespace kagami {
         }
     );
 
-    ObjectTraitsSetup(kTypeIdWideString, PlainDeliveryImpl<wstring>, PlainHasher<wstring>)
+    ObjectTraitsSetup(kTypeIdWideString, SharedDelivery, PlainHasher<wstring>)
       .InitComparator(PlainComparator<wstring>)
       .InitConstructor(
         FunctionImpl(NewWideString, "raw_string", "wstring")
@@ -13,7 +13,7 @@ namespace kagami {
   Message StringFamilySubStr(ObjectMap &p) {
     StringType &str = p.Cast<StringType>(kStrMe);
 
-    string type_id = p[kStrMe].GetTypeId();
+    TypeId type = p[kStrMe].GetType();
 
     int64_t start = p.Cast<int64_t>("start");
     int64_t size = p.Cast<int64_t>("size");
@@ -23,53 +23,51 @@ namespace kagami {
 
     StringType output = str.substr(start, size);
 
-    return Message().SetObject(Object(make_shared<StringType>(output), type_id));
+    return Message().SetObject(Object(MakePooled<StringType>(output), type));
   }
 
   template <class StringType>
   Message StringFamilyGetElement(ObjectMap &p) {
     StringType &str = p.Cast<StringType>(kStrMe);
-    string type_id = p[kStrMe].GetTypeId();
+    TypeId type = p[kStrMe].GetType();
 
     size_t size = str.size();
     size_t idx = p.Cast<int64_t>("index");
 
     EXPECT((idx < size && idx >= 0), "Index out of range.");
 
-    shared_ptr<StringType> output = make_shared<StringType>();
+    shared_ptr<StringType> output = MakePooled<StringType>();
 
     output->append(1, str[idx]);
-    return Message().SetObject(Object(output, type_id));
+    return Message().SetObject(Object(output, type));
   }
 
   template<class DestType,class SrcType>
   Message StringFamilyConverting(ObjectMap &p) {
     SrcType &str = p.Cast<SrcType>(kStrMe); 
-    string type_id;
+    TypeId type;
     Message msg;
     shared_ptr<DestType> dest;
 
     if constexpr (is_same<DestType, wstring>::value) {
-      dest = make_shared<wstring>(s2ws(str));
-      type_id = kTypeIdWideString;
+      dest = MakePooled<wstring>(s2ws(str));
+      type = kTypeWideString;
     }
     else if constexpr (is_same<DestType, string>::value) {
-      dest = make_shared<string>(ws2s(str));
-      type_id = kTypeIdString;
+      dest = MakePooled<string>(ws2s(str));
+      type = kTypeString;
     }
 
-    msg.SetObject(Object(dest, type_id));
+    msg.SetObject(Object(dest, type));
     return msg;
   }
 
   template <int base>
   Message DecimalConvert(ObjectMap &p) {
-    EXPECT_TYPE(p, "str", kTypeIdString);
+    EXPECT_TYPE(p, "str", kTypeString);
     string str = ParseRawString(p["str"].Cast<string>());
 
     int64_t dest = stol(str, nullptr, base);
-    return Message().SetObject(Object(
-      make_shared<int64_t>(dest), kTypeIdInt
-    ));
+    return Message().SetObject(Object(dest, kTypeIdInt));
   }
 }
\ No newline at end of file
@@ -255,28 +255,112 @@ namespace kagami::util {
   }
 
 
+  enum CharClass : uint8_t {
+    kCharIdHead = 1,
+    kCharIdBody = 2,
+    kCharDigit  = 4,
+    kCharSign   = 8,
+    kCharBlank  = 16,
+    kCharPunct  = 32
+  };
+
+  //Same character set as [[:punct:]] in "C" locale
+  const array<uint8_t, 256> &GetCharClassTable() {
+    static const array<uint8_t, 256> table = [] {
+      array<uint8_t, 256> result{};
+      for (int c = 0; c < 256; ++c) {
+        uint8_t flag = 0;
+        if (IsAlpha(char(c))) flag |= kCharIdHead | kCharIdBody;
+        if (IsDigit(char(c))) flag |= kCharIdBody | kCharDigit;
+        if (c == '_') flag |= kCharIdHead | kCharIdBody;
+        if (c == '+' || c == '-') flag |= kCharSign;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') flag |= kCharBlank;
+        if ((c >= 33 && c <= 47) || (c >= 58 && c <= 64) ||
+          (c >= 91 && c <= 96) || (c >= 123 && c <= 126)) flag |= kCharPunct;
+        result[c] = flag;
+      }
+      return result;
+    }();
+    return table;
+  }
+
+  inline uint8_t GetCharClass(char c) {
+    return GetCharClassTable()[static_cast<uint8_t>(c)];
+  }
+
+  bool IsSymbol(const char *head, size_t size) {
+    if (size == 1) return (GetCharClass(head[0]) & kCharPunct) != 0;
+    if (size != 2) return false;
+
+    switch (head[0]) {
+    case '=': return head[1] == '=';
+    case '<': return head[1] == '-' || head[1] == '=';
+    case '>': return head[1] == '=';
+    case '!': return head[1] == '=';
+    case '&': return head[1] == '&';
+    case '|': return head[1] == '|';
+    default: break;
+    }
+
+    return false;
+  }
+
   bool IsSymbol(string target) {
-    static const regex kPatternSymbol(R"(==|<-|<=|>=|!=|&&|\|\||[[:Punct:]])");
-    if (target.empty()) return false;
-    return std::regex_match(target, kPatternSymbol);
+    return IsSymbol(target.data(), target.size());
   }
 
   bool IsBoolean(string target) {
     return compare(target, "true", "false");
   }
 
-  StringType GetStringType(string src, bool ignore_symbol_rule) {
+  StringType GetStringType(string_view src, bool ignore_symbol_rule) {
+    TokenState state;
+    for (auto &unit : src) state.Push(unit);
+    return state.GetType(ignore_symbol_rule);
+  }
+
+  void TokenState::Push(char c) {
+    const uint8_t flag = GetCharClass(c);
+
+    if (size_ == 0) {
+      identifier_ = (flag & kCharIdHead) != 0;
+      digits_ = (flag & (kCharDigit | kCharSign)) != 0;
+      number_body_ = digits_;
+      blank_ = (flag & kCharBlank) != 0;
+    }
+    else {
+      identifier_ = identifier_ && (flag & kCharIdBody) != 0;
+      number_body_ = number_body_ && ((flag & kCharDigit) != 0 || c == '.');
+      digits_ = digits_ && (flag & kCharDigit) != 0;
+      blank_ = blank_ && (flag & kCharBlank) != 0;
+      if (c == '.') dots_ += 1;
+    }
+
+    if (size_ < sizeof(head_)) head_[size_] = c;
+    back_ = c;
+    size_ += 1;
+  }
+
+  StringType TokenState::GetType(bool ignore_symbol_rule) const {
     StringType type = kStringTypeNull;
-    if (src.empty())              type = kStringTypeNull;
-    else if (IsBoolean(src))      type = kStringTypeBool;
-    else if (IsIdentifier(src))   type = kStringTypeIdentifier;
-    else if (IsInteger(src))      type = kStringTypeInt;
-    else if (IsFloat(src))        type = kStringTypeFloat;
-    else if (IsBlank(src))        type = kStringTypeBlank;
-    else if (IsString(src))       type = kStringTypeString;
+    const bool sign_only = (size_ == 1 && (GetCharClass(head_[0]) & kCharSign));
+    const bool boolean =
+      (size_ == 4 && memcmp(head_, "true", 4) == 0) ||
+      (size_ == 5 && memcmp(head_, "false", 5) == 0);
+    const bool number = number_body_ && !sign_only && dots_ <= 1 &&
+      (size_ == 1 || IsDigit(back_));
+    const bool str = size_ > 1 && head_[0] == '\'' && back_ == '\'';
+
+    if (size_ == 0)                    type = kStringTypeNull;
+    else if (boolean)                  type = kStringTypeBool;
+    else if (identifier_)              type = kStringTypeIdentifier;
+    else if (digits_ && !sign_only)    type = kStringTypeInt;
+    else if (number)                   type = kStringTypeFloat;
+    else if (blank_)                   type = kStringTypeBlank;
+    else if (str)                      type = kStringTypeString;
 
     if (!ignore_symbol_rule) {
-      if (IsSymbol(src)) type = kStringTypeSymbol;
+      if (IsSymbol(head_, size_)) type = kStringTypeSymbol;
     }
     return type;
   }
@@ -355,10 +439,10 @@ namespace kagami::util {
     return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
   }
 
-  bool IsPlainType(string type_id) {
-    return type_id == kTypeIdInt ||
-      type_id == kTypeIdFloat ||
-      type_id == kTypeIdString ||
-      type_id == kTypeIdBool;
+  bool IsPlainType(TypeId type) {
+    return type == kTypeInt ||
+      type == kTypeFloat ||
+      type == kTypeString ||
+      type == kTypeBool;
   }
 }
\ No newline at end of file
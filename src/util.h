@@ -8,6 +8,7 @@ namespace kagami {
     bool IsMonoOperator(Keyword token);
     bool IsOperator(Keyword token);
     int GetTokenPriority(Keyword token);
+    map<string, Keyword> &GetKeywordBase();
     Keyword GetKeywordCode(string src);
     string GetRawString(string target);
     bool IsString(string target);
@@ -17,7 +18,7 @@ namespace kagami {
     bool IsBlank(string target);
     bool IsSymbol(string target);
     bool IsBoolean(string target);
-    StringType GetStringType(string target, bool ignore_symbol_rule = false);
+    StringType GetStringType(string_view target, bool ignore_symbol_rule = false);
     
     char GetEscapeChar(char target);
     wchar_t GetEscapeCharW(wchar_t target);
@@ -26,6 +27,40 @@ namespace kagami {
     string MakeBoolean(bool origin);
     bool IsDigit(char c);
     bool IsAlpha(char c);
-    bool IsPlainType(string type_id);
+    bool IsPlainType(TypeId type);
+
+    /*
+      Incremental form of GetStringType().
+      Every character is classified by lookup table, and properties of the
+      token so far are kept in state, so that type of a growing token is
+      given in constant time instead of rescanning it.
+    */
+    class TokenState {
+    private:
+      size_t size_;
+      char head_[5];
+      char back_;
+      bool identifier_;
+      bool digits_;
+      bool number_body_;
+      bool blank_;
+      size_t dots_;
+
+    public:
+      TokenState() :
+        size_(0),
+        head_(),
+        back_(0),
+        identifier_(false),
+        digits_(false),
+        number_body_(false),
+        blank_(false),
+        dots_(0) {}
+
+      void Push(char c);
+      StringType GetType(bool ignore_symbol_rule = false) const;
+      size_t size() const { return size_; }
+      void Clear() { *this = TokenState(); }
+    };
   };
 }
\ No newline at end of file
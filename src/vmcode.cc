@@ -1,7 +1,7 @@
 #include "vmcode.h"
 
 namespace kagami {
-  bool VMCode::FindJumpRecord(size_t index, stack<size_t> &dest) {
+  bool VMCode::FindJumpRecord(size_t index, stack<size_t> &dest) const {
     bool found = false;
     while (!dest.empty()) dest.pop();
 
@@ -15,4 +15,274 @@ namespace kagami {
 
     return found;
   }
-}
\ No newline at end of file
+
+  /*
+    Remove marked commands from code.
+    Nest/jump indexes which point to a removed command are moved to the
+    next remaining command.
+  */
+  void VMCode::Compact(vector<bool> &removed) {
+    vector<size_t> new_index(size() + 1, 0);
+    deque<Command> remaining;
+    unordered_map<size_t, list<size_t>> jump_record;
+    size_t counter = 0;
+
+    for (size_t idx = 0; idx < size(); ++idx) {
+      new_index[idx] = counter;
+      if (!removed[idx]) counter += 1;
+    }
+
+    new_index[size()] = counter;
+
+    for (size_t idx = 0; idx < size(); ++idx) {
+      if (removed[idx]) continue;
+
+      auto &option = (*this)[idx].first.option;
+      option.nest = new_index[option.nest];
+      option.nest_end = new_index[option.nest_end];
+      remaining.emplace_back((*this)[idx]);
+    }
+
+    for (auto &unit : jump_record_) {
+      if (removed[unit.first]) continue;
+
+      list<size_t> record;
+      for (auto &dest : unit.second) record.push_back(new_index[dest]);
+      jump_record.emplace(new_index[unit.first], record);
+    }
+
+    deque<Command>::swap(remaining);
+    jump_record_.swap(jump_record);
+  }
+
+  Object ParseLiteral(const string &value, StringType type) {
+    Object obj;
+
+    if (type == kStringTypeInt) {
+      int64_t int_value;
+      from_chars(value.data(), value.data() + value.size(), int_value);
+      obj = Object(int_value, kTypeIdInt);
+    }
+    else if (type == kStringTypeFloat) {
+      double float_value;
+#if not defined (_MSC_VER)
+      float_value = stod(value);
+#else
+      from_chars(value.data(), value.data() + value.size(), float_value);
+#endif
+      obj = Object(float_value, kTypeIdFloat);
+    }
+    else {
+      switch (type) {
+      case kStringTypeBool:
+        obj = Object(value == kStrTrue, kTypeIdBool);
+        break;
+      case kStringTypeString:
+        obj.PackContent(MakePooled<string>(util::IsString(value) ?
+          util::GetRawString(value) : value), kTypeIdString);
+        break;
+      case kStringTypeIdentifier:
+        obj.PackContent(MakePooled<string>(value), kTypeIdString);
+        break;
+      default:
+        break;
+      }
+    }
+
+    return obj;
+  }
+
+  Operand Bytecode::MakeOperand(const Argument &arg,
+    unordered_map<string, uint32_t> &constant_index,
+    unordered_map<string, uint32_t> &name_index) {
+    Operand operand{ 
+      static_cast<uint8_t>(arg.GetType()), 
+      static_cast<uint8_t>(arg.GetStringType()), 
+      kNullSlot, 0 
+    };
+
+    auto &data = arg.GetData();
+
+    if (arg.GetType() == kArgumentNormal) {
+      if (auto it = constant_index.find(data); it != constant_index.end()) {
+        operand.index = it->second;
+      }
+      else {
+        operand.index = static_cast<uint32_t>(constants_.size());
+        constants_.push_back(ParseLiteral(data, arg.GetStringType()));
+        constant_index.emplace(data, operand.index);
+      }
+    }
+    else if (arg.GetType() == kArgumentObjectStack) {
+      if (auto it = name_index.find(data); it != name_index.end()) {
+        operand.index = it->second;
+      }
+      else {
+        operand.index = static_cast<uint32_t>(names_.size());
+        names_.push_back(data);
+        name_index.emplace(data, operand.index);
+      }
+    }
+
+    return operand;
+  }
+
+  /*
+    A name can't be resolved to slot if it may be created in a nested scope
+    (local binding/function definition inside while/for/case, or unit of
+    for-each), because that object would hide the one stored in slot.
+    Bodies of nested function are skipped, they belong to their own code.
+  */
+  void Bytecode::ResolveSlots(VMCode &code, size_t offset, vector<bool> &nested) {
+    size_t size = code.size();
+    int depth = 0;
+    vector<int> scope_mark(size + 1, 0);
+    vector<string> candidates;
+    unordered_map<string, bool> excluded;
+
+    nested.assign(size, false);
+    slots_.clear();
+
+    for (size_t idx = 0; idx < size; ++idx) {
+      auto &request = code[idx].first;
+
+      if (request.type != kRequestCommand) continue;
+
+      auto token = request.GetKeywordValue();
+
+      if (token == kKeywordFn) {
+        size_t end = request.option.nest_end - offset;
+        for (size_t pos = idx + 1; pos < end && pos < size; ++pos) {
+          nested[pos] = true;
+        }
+        idx = end - 1;
+      }
+      else if (token == kKeywordEnd && compare(request.option.nest_root, 
+        kKeywordWhile, kKeywordFor, kKeywordCase)) {
+        scope_mark[request.option.nest - offset] += 1;
+        scope_mark[idx + 1] -= 1;
+      }
+    }
+
+    auto add_name = [&](const string &id, bool exclude) -> void {
+      auto it = excluded.find(id);
+      if (it == excluded.end()) {
+        candidates.push_back(id);
+        excluded.emplace(id, exclude);
+      }
+      else if (exclude) {
+        it->second = true;
+      }
+    };
+
+    for (size_t idx = 0; idx < size; ++idx) {
+      depth += scope_mark[idx];
+
+      if (nested[idx]) continue;
+
+      auto &request = code[idx].first;
+      auto &args = code[idx].second;
+      auto token = request.GetKeywordValue();
+
+      if (request.type == kRequestExt) {
+        auto &domain = request.GetInterfaceDomain();
+        if (domain.GetType() == kArgumentObjectStack) {
+          add_name(domain.GetData(), false);
+        }
+      }
+
+      if (compare(token, kKeywordFn, kKeywordFor)) {
+        if (!args.empty()) {
+          add_name(args[0].GetData(), token == kKeywordFor || depth > 0);
+        }
+
+        if (token == kKeywordFn) continue;
+      }
+
+      if (compare(token, kKeywordBind, kKeywordDeliver) && !args.empty() &&
+        args[0].GetType() == kArgumentNormal) {
+        add_name(args[0].GetData(), request.option.local_object && depth > 0);
+      }
+
+      for (auto &arg : args) {
+        if (arg.GetType() == kArgumentObjectStack) {
+          add_name(arg.GetData(), false);
+        }
+      }
+    }
+
+    for (auto &unit : candidates) {
+      if (excluded[unit] || slots_.size() >= kNullSlot) continue;
+      slots_.emplace(unit, static_cast<uint16_t>(slots_.size()));
+    }
+  }
+
+  void Bytecode::Assemble(VMCode &code, size_t offset) {
+    unordered_map<string, uint32_t> constant_index;
+    unordered_map<string, uint32_t> name_index;
+    vector<bool> nested;
+    size_t operand_count = 0, idx = 0;
+
+    instructions_.clear();
+    operands_.clear();
+    constants_.clear();
+    names_.clear();
+    call_cache_count_ = 0;
+
+    ResolveSlots(code, offset, nested);
+
+    auto resolve = [&](Operand &operand, const Argument &arg) -> void {
+      bool identifier = arg.GetType() == kArgumentObjectStack ||
+        (arg.GetType() == kArgumentNormal && 
+          arg.GetStringType() == kStringTypeIdentifier);
+      if (identifier && !nested[idx]) operand.slot = FindSlot(arg.GetData());
+    };
+
+    for (auto &unit : code) operand_count += unit.second.size();
+
+    instructions_.reserve(code.size());
+    operands_.reserve(operand_count);
+
+    for (; idx < code.size(); ++idx) {
+      auto &unit = code[idx];
+      auto &request = unit.first;
+      Instruction inst{};
+
+      inst.type = static_cast<uint8_t>(request.type);
+      inst.flags = 
+        (request.option.void_call ? kInstructionVoidCall : 0) |
+        (request.option.local_object ? kInstructionLocalObject : 0);
+      inst.keyword = static_cast<uint16_t>(request.GetKeywordValue());
+      inst.nest_root = static_cast<uint16_t>(request.option.nest_root);
+      inst.fused_op = static_cast<uint16_t>(request.option.fused_op);
+      inst.escape_depth = static_cast<uint16_t>(request.option.escape_depth);
+      inst.line = static_cast<uint32_t>(request.idx);
+      inst.operand = static_cast<uint32_t>(operands_.size());
+      inst.argc = static_cast<uint32_t>(unit.second.size());
+      inst.nest = static_cast<uint32_t>(request.option.nest);
+      inst.nest_end = static_cast<uint32_t>(request.option.nest_end);
+      inst.domain = Operand{ kArgumentNull, kStringTypeNull, kNullSlot, 0 };
+      inst.interface_slot = kNullSlot;
+      inst.call_cache = kNullCallCache;
+
+      if (request.type == kRequestExt) {
+        Argument id(request.GetInterfaceId(), 
+          kArgumentObjectStack, kStringTypeIdentifier);
+        auto &domain = request.GetInterfaceDomain();
+        inst.interface_id = MakeOperand(id, constant_index, name_index).index;
+        inst.call_cache = static_cast<uint32_t>(call_cache_count_);
+        call_cache_count_ += 1;
+        if (!nested[idx]) inst.interface_slot = FindSlot(id.GetData());
+        inst.domain = MakeOperand(domain, constant_index, name_index);
+        resolve(inst.domain, domain);
+      }
+
+      for (auto &arg : unit.second) {
+        operands_.push_back(MakeOperand(arg, constant_index, name_index));
+        resolve(operands_.back(), arg);
+      }
+
+      instructions_.push_back(inst);
+    }
+  }
+}
@@ -23,6 +23,7 @@ namespace kagami {
     size_t nest_end;
     size_t escape_depth;
     Keyword nest_root;
+    Keyword fused_op;
 
     RequestOption() : 
       void_call(false), 
@@ -30,7 +31,8 @@ namespace kagami {
       nest(0),
       nest_end(0),
       escape_depth(0),
-      nest_root(kKeywordNull) {}
+      nest_root(kKeywordNull),
+      fused_op(kKeywordNull) {}
   };
 
   class Argument {
@@ -58,11 +60,11 @@ namespace kagami {
     //  domain_.push_back(arg);
     //}
 
-    auto GetData() { return data_; }
+    const string &GetData() const { return data_; }
 
-    auto GetType() { return type_; }
+    ArgumentType GetType() const { return type_; }
 
-    StringType GetStringType() { return token_type_; }
+    StringType GetStringType() const { return token_type_; }
 
     //bool HasDomain() { return !domain_.empty(); }
 
@@ -105,20 +107,25 @@ namespace kagami {
       type(kRequestNull),
       option() {}
 
-    string GetInterfaceId() {
+    //Views below are valid as long as the request itself
+    const string &GetInterfaceId() const {
+      static const string empty;
+
       if (type == kRequestExt) {
         return std::get<FunctionInfo>(data_).id;
       }
 
-      return string();
+      return empty;
     }
 
-    Argument GetInterfaceDomain() {
+    const Argument &GetInterfaceDomain() const {
+      static const Argument empty;
+
       if (type == kRequestExt) {
         return std::get<FunctionInfo>(data_).domain;
       }
 
-      return Argument();
+      return empty;
     }
 
     Keyword GetKeywordValue() {
@@ -137,17 +144,279 @@ namespace kagami {
   using ArgumentList = deque<Argument>;
   using Command = pair<Request, ArgumentList>;
 
+  /* Compact machine code */
+  const uint16_t kNullSlot = 0xFFFF;
+  const uint32_t kNullCallCache = 0xFFFFFFFF;
+  const uint8_t kQuickNone = 0;
+  const uint8_t kQuickGeneric = 0xFF;
+
+  class FunctionImpl;
+
+  struct Operand {
+    uint8_t type;
+    uint8_t token_type;
+    uint16_t slot;
+    uint32_t index;
+
+    ArgumentType GetType() const { 
+      return static_cast<ArgumentType>(type); 
+    }
+
+    StringType GetStringType() const { 
+      return static_cast<StringType>(token_type); 
+    }
+
+    bool IsPlaceholder() const {
+      return type == kArgumentNull;
+    }
+
+    bool HasSlot() const {
+      return slot != kNullSlot;
+    }
+  };
+
+  enum InstructionFlag {
+    kInstructionVoidCall = 1,
+    kInstructionLocalObject = 2
+  };
+
+  /*
+    Fixed-width instruction.
+    Operands of all instructions are stored in one buffer, and instruction
+    only records the position and count of its own operands.
+    Superinstruction records the operator merged into it in 'fused_op'.
+    Instruction is never written after assembling, see BytecodeState.
+  */
+  struct Instruction {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t keyword;
+    uint16_t nest_root;
+    uint16_t fused_op;
+    uint16_t escape_depth;
+    uint32_t line;
+    uint32_t operand;
+    uint32_t argc;
+    uint32_t interface_id;
+    uint16_t interface_slot;
+    uint32_t call_cache;
+    Operand domain;
+    uint32_t nest;
+    uint32_t nest_end;
+
+    RequestType GetType() const { 
+      return static_cast<RequestType>(type); 
+    }
+
+    Keyword GetKeywordValue() const { 
+      return static_cast<Keyword>(keyword); 
+    }
+
+    Keyword GetNestRoot() const { 
+      return static_cast<Keyword>(nest_root); 
+    }
+
+    Keyword GetFusedOp() const {
+      return static_cast<Keyword>(fused_op);
+    }
+
+    bool IsFused() const {
+      return fused_op != kKeywordNull;
+    }
+
+    bool IsVoidCall() const { 
+      return (flags & kInstructionVoidCall) != 0; 
+    }
+
+    bool IsLocalObject() const { 
+      return (flags & kInstructionLocalObject) != 0; 
+    }
+  };
+
+  class OperandList {
+  private:
+    const Operand *begin_;
+    size_t size_;
+
+  public:
+    OperandList() : begin_(nullptr), size_(0) {}
+
+    OperandList(const Operand *begin, size_t size) :
+      begin_(begin), size_(size) {}
+
+    const Operand &operator[](size_t idx) const { return begin_[idx]; }
+    const Operand &back() const { return begin_[size_ - 1]; }
+    const Operand *begin() const { return begin_; }
+    const Operand *end() const { return begin_ + size_; }
+    std::reverse_iterator<const Operand *> rbegin() const { 
+      return std::reverse_iterator<const Operand *>(end()); 
+    }
+    std::reverse_iterator<const Operand *> rend() const { 
+      return std::reverse_iterator<const Operand *>(begin()); 
+    }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+  };
+
+  /*
+    Inline cache of function resolution for single call instruction.
+    Entries are keyed on type of receiver (kTypeNull for plain function),
+    and all of them are dropped when function table is changed.
+  */
+  class CallSiteCache {
+  private:
+    static const size_t kMaxEntries = 4;
+
+    array<pair<TypeId, FunctionImpl *>, kMaxEntries> entries_;
+    size_t count_;
+    uint64_t epoch_;
+
+  public:
+    CallSiteCache() : entries_(), count_(0), epoch_(0) {}
+
+    bool Find(TypeId type, uint64_t epoch, FunctionImpl *&impl) {
+      if (epoch != epoch_) return false;
+
+      for (size_t idx = 0; idx < count_; ++idx) {
+        if (entries_[idx].first == type) {
+          impl = entries_[idx].second;
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    void Add(TypeId type, uint64_t epoch, FunctionImpl *impl) {
+      if (epoch != epoch_) {
+        count_ = 0;
+        epoch_ = epoch;
+      }
+
+      if (count_ < kMaxEntries) {
+        entries_[count_] = std::make_pair(type, impl);
+        count_ += 1;
+      }
+    }
+  };
+
+  class VMCode;
+
+  /*
+    Literal values are parsed once while assembling and kept in constant
+    pool of Bytecode. These objects are immutable, machine only delivers
+    copies of them.
+    Names which can only be stored in the outermost scope of a function
+    (or the script itself) are resolved to numbered frame slots.
+    Bytecode is read-only after assembling, so one copy can be run by
+    several machines at the same time.
+  */
+  class Bytecode {
+  private:
+    vector<Instruction> instructions_;
+    vector<Operand> operands_;
+    vector<Object> constants_;
+    vector<string> names_;
+    size_t call_cache_count_;
+    unordered_map<string, uint16_t> slots_;
+
+    void ResolveSlots(VMCode &code, size_t offset, vector<bool> &nested);
+
+    Operand MakeOperand(const Argument &arg, 
+      unordered_map<string, uint32_t> &constant_index,
+      unordered_map<string, uint32_t> &name_index);
+
+  public:
+    Bytecode() :
+      instructions_(),
+      operands_(),
+      constants_(),
+      names_(),
+      call_cache_count_(0),
+      slots_() {}
+
+    void Assemble(VMCode &code, size_t offset);
+
+    const Instruction &operator[](size_t idx) const { return instructions_[idx]; }
+    size_t size() const { return instructions_.size(); }
+    bool empty() const { return instructions_.empty(); }
+
+    OperandList GetOperands(const Instruction &inst) const {
+      return OperandList(operands_.data() + inst.operand, inst.argc);
+    }
+
+    const string &GetName(uint32_t index) const { return names_[index]; }
+
+    const Object &GetConstant(uint32_t index) const { return constants_[index]; }
+
+    size_t GetCallCacheCount() const { return call_cache_count_; }
+
+    size_t GetSlotCount() const { return slots_.size(); }
+
+    uint16_t FindSlot(const string &id) const {
+      auto it = slots_.find(id);
+      return it != slots_.end() ? it->second : kNullSlot;
+    }
+
+    const string &GetIdentifier(const Operand &operand) const {
+      return operand.GetType() == kArgumentObjectStack ?
+        names_[operand.index] : constants_[operand.index].Cast<string>();
+    }
+  };
+
+  /*
+    Run-time state of one Bytecode, written while machine is running it.
+    Operator instructions keep plain type codes they have seen in quickening
+    record of their index, and call instructions own call-site caches.
+    It's kept by owner of execution (machine for entry code and function
+    object for its body) instead of Bytecode, which may be shared.
+  */
+  class BytecodeState {
+  private:
+    vector<uint8_t> quick_;
+    vector<CallSiteCache> call_caches_;
+
+  public:
+    BytecodeState() : quick_(), call_caches_() {}
+
+    explicit BytecodeState(const Bytecode &code) :
+      quick_(code.size(), kQuickNone),
+      call_caches_(code.GetCallCacheCount()) {}
+
+    uint8_t &GetQuick(size_t idx) { return quick_[idx]; }
+
+    CallSiteCache &GetCallCache(const Instruction &inst) {
+      return call_caches_[inst.call_cache];
+    }
+  };
+
+  Object ParseLiteral(const string &value, StringType type);
+
   class VMCode : public deque<Command> {
   protected:
     unordered_map<size_t, list<size_t>> jump_record_;
+    Bytecode bytecode_;
 
   public:
     void AddJumpRecord(size_t index, list<size_t> record) {
       jump_record_.emplace(std::make_pair(index, record));
     }
 
-    bool FindJumpRecord(size_t index, stack<size_t> &dest);
+    bool FindJumpRecord(size_t index, stack<size_t> &dest) const;
+    bool HasJumpRecord(size_t index) const { return jump_record_.count(index) != 0; }
+    const unordered_map<size_t, list<size_t>> &GetJumpRecords() const { return jump_record_; }
+    void Compact(vector<bool> &removed);
+
+    void Assemble(size_t offset = 0) { bytecode_.Assemble(*this, offset); }
+
+    const Bytecode &GetBytecode() const { return bytecode_; }
   };
 
-  using VMCodePointer = VMCode * ;
+  using VMCodePointer = const VMCode * ;
+
+  //Entry of code stack: code and run-time state of its bytecode
+  struct CodeRecord {
+    VMCodePointer code;
+    BytecodeState *state;
+  };
 }
\ No newline at end of file